@@ -0,0 +1,37 @@
+#ifndef WFF2CNF_RANDOMTREE_HPP
+#define WFF2CNF_RANDOMTREE_HPP
+
+#include "src/AST.hpp"
+#include "src/Operators.hpp"
+#include <random>
+#include <string>
+#include <vector>
+
+// Random WFF with exactly the given number of nodes over the given variables, with subtrees split at random so its depth
+// stays logarithmic on average
+inline AST_node* randomTree(std::mt19937& rng,
+                            const size_t nodes,
+                            const Operators& ops,
+                            const std::vector<std::string>& variables)
+{
+    static const OperatorKind BINARY_KINDS[] = {OP_AND, OP_OR, OP_XOR, OP_IMPLIES, OP_IFF};
+    if (nodes == 1)
+    {
+        return new AST_node(Token(VARIABLE, variables[rng() % variables.size()]));
+    }
+
+    AST_node* node;
+    if (nodes == 2 || rng() % 8 == 0)
+    {
+        node = new AST_node(Token(OPERATOR, ops.getLexeme(OP_NOT)));
+        node->children.push_back(randomTree(rng, nodes - 1, ops, variables));
+        return node;
+    }
+    size_t left = 1 + rng() % (nodes - 2);
+    node = new AST_node(Token(OPERATOR, ops.getLexeme(BINARY_KINDS[rng() % 5])));
+    node->children.push_back(randomTree(rng, left, ops, variables));
+    node->children.push_back(randomTree(rng, nodes - 1 - left, ops, variables));
+    return node;
+}
+
+#endif //WFF2CNF_RANDOMTREE_HPP
@@ -0,0 +1,367 @@
+// Compares the AST_node layout with CompactAST on a random WFF: memory, equality, printing, evaluation and pattern
+// matching, each with its wall time and, where the kernel allows it, the cache misses it caused.
+//
+// Usage: WFF2CNF_layout_benchmark [nodes]
+//
+// CompactAST is not used by any pipeline stage yet, this only measures what switching to it would gain.
+
+#include "RandomTree.hpp"
+#include "src/AST.hpp"
+#include "src/CompactAST.hpp"
+#include "src/Operators.hpp"
+#include "src/Symbols.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware cache miss counters for the calling thread. Either counter reads as -1 when the platform or the kernel's
+// perf_event_paranoid setting doesn't allow it.
+class CacheMissCounter
+{
+private:
+    int l1d_fd = -1;
+    int llc_fd = -1;
+
+    static int open(const uint32_t type, const uint64_t config)
+    {
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+        (void)type;
+        (void)config;
+        return -1;
+#endif
+    }
+
+    static void control(const int fd, const unsigned long request)
+    {
+#ifdef __linux__
+        if (fd >= 0)
+        {
+            ioctl(fd, request, 0);
+        }
+#else
+        (void)fd;
+        (void)request;
+#endif
+    }
+
+    static int64_t read(const int fd)
+    {
+#ifdef __linux__
+        int64_t count;
+        if (fd >= 0 && ::read(fd, &count, sizeof(count)) == sizeof(count))
+        {
+            return count;
+        }
+#else
+        (void)fd;
+#endif
+        return -1;
+    }
+
+public:
+    CacheMissCounter()
+    {
+#ifdef __linux__
+        l1d_fd = open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+                                          | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                          | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        llc_fd = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#endif
+    }
+
+    ~CacheMissCounter()
+    {
+#ifdef __linux__
+        for (int fd : {l1d_fd, llc_fd})
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    CacheMissCounter(const CacheMissCounter&) = delete;
+    CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+    void start()
+    {
+#ifdef __linux__
+        for (int fd : {l1d_fd, llc_fd})
+        {
+            control(fd, PERF_EVENT_IOC_RESET);
+            control(fd, PERF_EVENT_IOC_ENABLE);
+        }
+#endif
+    }
+
+    void stop()
+    {
+#ifdef __linux__
+        for (int fd : {l1d_fd, llc_fd})
+        {
+            control(fd, PERF_EVENT_IOC_DISABLE);
+        }
+#endif
+    }
+
+    int64_t getL1dMisses() const { return read(l1d_fd); }
+    int64_t getLlcMisses() const { return read(llc_fd); }
+};
+
+// Heap bytes of a tree of AST_nodes, not counting allocator overhead
+static size_t pointerTreeBytes(const AST_node* root)
+{
+    size_t bytes = 0;
+    std::vector<const AST_node*> stack = {root};
+    while (!stack.empty())
+    {
+        const AST_node* curr = stack.back();
+        stack.pop_back();
+        bytes += sizeof(AST_node) + curr->children.capacity() * sizeof(AST_node*);
+        if (curr->token.lexeme.capacity() > std::string().capacity()) // Beyond the small string buffer
+        {
+            bytes += curr->token.lexeme.capacity() + 1;
+        }
+        stack.insert(stack.end(), curr->children.begin(), curr->children.end());
+    }
+    return bytes;
+}
+
+// Every token's dense id in pre-order: the index of a variable in CompactAST::getVariables(), or OPERATOR_BIT plus the
+// OperatorKind. Resolved once before timing, so evaluating the AST_node layout pays for following its pointers but, like
+// CompactAST, not for looking up names.
+static const uint32_t OPERATOR_BIT = 1u << 31;
+
+static void resolveTokens(const AST_node* root,
+                          const Operators& ops,
+                          const std::vector<std::string>& variables,
+                          std::vector<uint32_t>& ids)
+{
+    std::map<std::string,uint32_t> variable_ids;
+    for (size_t v=0; v<variables.size(); v++)
+    {
+        variable_ids[variables[v]] = static_cast<uint32_t>(v);
+    }
+
+    std::vector<const AST_node*> stack = {root};
+    while (!stack.empty())
+    {
+        const AST_node* curr = stack.back();
+        stack.pop_back();
+        ids.push_back(curr->token.type == VARIABLE ? variable_ids.at(curr->token.lexeme)
+                                                   : OPERATOR_BIT | ops.getProperties(curr->token.lexeme).kind);
+        stack.insert(stack.end(), curr->children.rbegin(), curr->children.rend());
+    }
+}
+
+static uint64_t evaluateTree(const AST_node* curr, const uint32_t*& id, const std::vector<uint64_t>& values)
+{
+    const uint32_t code = *id++;
+    if (!(code & OPERATOR_BIT))
+    {
+        return values[code];
+    }
+    uint64_t left = evaluateTree(curr->children[0], id, values);
+    const OperatorKind kind = static_cast<OperatorKind>(code & ~OPERATOR_BIT);
+    if (kind == OP_NOT)
+    {
+        return ~left;
+    }
+    uint64_t right = evaluateTree(curr->children[1], id, values);
+    switch (kind)
+    {
+        case OP_AND:     return left & right;
+        case OP_OR:      return left | right;
+        case OP_XOR:     return left ^ right;
+        case OP_IFF:     return ~(left ^ right);
+        case OP_IMPLIES: return ~left | right;
+        default:         return 0;
+    }
+}
+
+// The matching Transformer does on AST_nodes: operators and constants compared by lexeme, and each pattern variable
+// bound to a deep copy of the first subtree it meets
+static bool matchTree(const AST_node* wff,
+                      const AST_node* pattern,
+                      const Operators& ops,
+                      std::map<std::string,AST_node*>& bindings)
+{
+    if (pattern->token.type == VARIABLE)
+    {
+        auto it = bindings.find(pattern->token.lexeme);
+        if (it != bindings.end())
+        {
+            return is_equal(wff, it->second);
+        }
+        bindings.insert({pattern->token.lexeme, deep_copy(wff)});
+        return true;
+    }
+    if (wff->token.lexeme != pattern->token.lexeme)
+    {
+        return false;
+    }
+    for (int i=0; i<ops.getNumOperands(pattern->token.lexeme); i++)
+    {
+        if (!matchTree(wff->children[i], pattern->children[i], ops, bindings))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t countTreeMatches(const AST_node* root, const AST_node* pattern, const Operators& ops)
+{
+    size_t count = 0;
+    std::map<std::string,AST_node*> bindings;
+    std::vector<const AST_node*> stack = {root};
+    while (!stack.empty())
+    {
+        const AST_node* curr = stack.back();
+        stack.pop_back();
+        count += matchTree(curr, pattern, ops, bindings);
+        for (auto& binding : bindings)
+        {
+            AST::deleteTree(binding.second);
+        }
+        bindings.clear();
+        stack.insert(stack.end(), curr->children.begin(), curr->children.end());
+    }
+    return count;
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t nodes = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    if (nodes == 0)
+    {
+        std::cerr << "The WFF needs at least one node" << std::endl;
+        return 1;
+    }
+
+    Symbols symbols =
+    {
+        {
+            {"1", CONST_TRUE},
+            {"0", CONST_FALSE}
+        },
+        {
+            {"a"}, {"b"}, {"c"}, {"p"}, {"q"}, {"r"}, {"s"}, {"t"}
+        }
+    };
+
+    Operators ops = {
+            {"!", {5, NOT_ASSOCIATIVE, UNARY, OP_NOT}},
+            {"*", {4, ASSOCIATIVE, BINARY, OP_AND}},
+            {"^", {3, ASSOCIATIVE, BINARY, OP_XOR}},
+            {"+", {2, ASSOCIATIVE, BINARY, OP_OR}},
+            {"=>", {1, NOT_ASSOCIATIVE, BINARY, OP_IMPLIES}},
+            {"<=>", {0, NOT_ASSOCIATIVE, BINARY, OP_IFF}}
+    };
+
+    CacheMissCounter counter;
+    auto time = [&counter](const char* label, auto&& function)
+    {
+        counter.start();
+        auto start = std::chrono::high_resolution_clock::now();
+        auto result = function();
+        auto elapsed = std::chrono::high_resolution_clock::now() - start;
+        counter.stop();
+
+        std::cout << "  " << label << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << " ms";
+        if (counter.getL1dMisses() >= 0 || counter.getLlcMisses() >= 0)
+        {
+            std::cout << ", L1d misses " << counter.getL1dMisses() << ", LLC misses " << counter.getLlcMisses();
+        }
+        std::cout << std::endl;
+        return result;
+    };
+
+    const std::vector<std::string> variables = {"a", "b", "c", "p", "q", "r", "s", "t"};
+    std::mt19937 rng(2024);
+    AST wff(symbols, ops, randomTree(rng, nodes, ops, variables));
+    AST wff_copy(wff);
+    std::cout << "Layout benchmark, " << nodes << " nodes" << std::endl;
+    if (counter.getL1dMisses() < 0 && counter.getLlcMisses() < 0)
+    {
+        std::cout << "  (Cache miss counters are unavailable here)" << std::endl;
+    }
+
+    CompactAST compact = time("CompactAST build:     ", [&]() { return CompactAST(symbols, ops, wff); });
+    CompactAST compact_copy(compact);
+    size_t pointer_bytes = pointerTreeBytes(wff.getRoot());
+    std::cout << "  Memory:               AST " << pointer_bytes << " bytes (" << pointer_bytes / nodes
+              << "/node), CompactAST " << compact.memoryBytes() << " bytes (" << compact.memoryBytes() / nodes
+              << "/node)" << std::endl;
+
+    bool equal = time("is_equal AST:         ", [&]() { return is_equal(wff.getRoot(), wff_copy.getRoot()); });
+    bool compact_equal = time("isEqual CompactAST:   ", [&]() { return compact.isEqual(compact_copy); });
+
+    std::string printed = time("toString AST:         ", [&]() { return wff.toString(); });
+    std::string compact_printed = time("toString CompactAST:  ", [&]() { return compact.toString(); });
+
+    // Both layouts read the same dense value array
+    std::vector<uint64_t> values;
+    for (size_t v=0; v<compact.getVariables().size(); v++)
+    {
+        values.push_back((static_cast<uint64_t>(rng()) << 32) | rng());
+    }
+    std::vector<uint32_t> ids;
+    resolveTokens(wff.getRoot(), ops, compact.getVariables(), ids);
+    uint64_t result = time("evaluate AST:         ", [&]()
+    {
+        const uint32_t* id = ids.data();
+        return evaluateTree(wff.getRoot(), id, values);
+    });
+    uint64_t compact_result = time("evaluate CompactAST:  ", [&]() { return compact.evaluate(values); });
+
+    AST pattern(symbols, ops, "(a*b)+c");
+    CompactAST compact_pattern(symbols, ops, pattern);
+    size_t matches = time("match AST:            ", [&]()
+    {
+        return countTreeMatches(wff.getRoot(), pattern.getRoot(), ops);
+    });
+    size_t compact_matches = time("match CompactAST:     ", [&]()
+    {
+        size_t count = 0;
+        std::vector<size_t> bindings;
+        for (size_t i=0; i<compact.size(); i++)
+        {
+            count += compact.match(i, compact_pattern, bindings);
+        }
+        return count;
+    });
+    std::cout << "  " << compact_matches << " nodes match " << compact_pattern.toString() << std::endl;
+
+    if (!equal || !compact_equal || printed != compact_printed || result != compact_result
+        || matches != compact_matches)
+    {
+        std::cerr << "The layouts disagree" << std::endl;
+        return 1;
+    }
+    return 0;
+}
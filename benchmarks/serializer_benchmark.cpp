@@ -0,0 +1,131 @@
+// Times Serializer::toString() against toStringParallel() with growing thread counts, on a random WFF and on a CNF of
+// 3-literal clauses of about the same size.
+//
+// Usage: WFF2CNF_serializer_benchmark [nodes]
+
+#include "RandomTree.hpp"
+#include "src/AST.hpp"
+#include "src/Operators.hpp"
+#include "src/Serializer.hpp"
+#include "src/Symbols.hpp"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// count random 3-literal clauses joined by balanced ANDs, which prints exactly like a flat chain
+static AST_node* randomCnf(std::mt19937& rng,
+                           const size_t count,
+                           const Operators& ops,
+                           const std::vector<std::string>& variables)
+{
+    if (count == 1)
+    {
+        AST_node* clause = nullptr;
+        for (int i=0; i<3; i++)
+        {
+            AST_node* literal = new AST_node(Token(VARIABLE, variables[rng() % variables.size()]));
+            if (rng() % 2)
+            {
+                AST_node* negation = new AST_node(Token(OPERATOR, ops.getLexeme(OP_NOT)));
+                negation->children.push_back(literal);
+                literal = negation;
+            }
+            if (clause)
+            {
+                AST_node* disjunction = new AST_node(Token(OPERATOR, ops.getLexeme(OP_OR)));
+                disjunction->children = {clause, literal};
+                literal = disjunction;
+            }
+            clause = literal;
+        }
+        return clause;
+    }
+
+    AST_node* conjunction = new AST_node(Token(OPERATOR, ops.getLexeme(OP_AND)));
+    conjunction->children.push_back(randomCnf(rng, count / 2, ops, variables));
+    conjunction->children.push_back(randomCnf(rng, count - count / 2, ops, variables));
+    return conjunction;
+}
+
+static bool benchmark(const char* name, const AST& wff, const Serializer& serializer)
+{
+    auto time = [](auto&& function)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        function();
+        auto elapsed = std::chrono::high_resolution_clock::now() - start;
+        return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    };
+
+    std::string expected;
+    std::cout << name << std::endl;
+    std::cout << "  toString:                " << time([&]() { expected = serializer.toString(wff.getRoot()); })
+              << " ms, " << expected.size() << " chars" << std::endl;
+
+    bool identical = true;
+    std::vector<unsigned> thread_counts = {2, 4, 8};
+    if (std::thread::hardware_concurrency() > 8)
+    {
+        thread_counts.push_back(std::thread::hardware_concurrency());
+    }
+    for (unsigned threads : thread_counts)
+    {
+        std::string result;
+        auto elapsed = time([&]() { result = serializer.toStringParallel(wff.getRoot(), threads); });
+        std::cout << "  toStringParallel, " << threads << (threads < 10 ? " " : "") << " threads: " << elapsed << " ms"
+                  << std::endl;
+        identical = identical && result == expected;
+    }
+    return identical;
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t nodes = argc > 1 ? std::stoul(argv[1]) : 5000000;
+    if (nodes < 8)
+    {
+        std::cerr << "The WFF needs at least 8 nodes" << std::endl;
+        return 1;
+    }
+
+    Symbols symbols =
+    {
+        {
+            {"1", CONST_TRUE},
+            {"0", CONST_FALSE}
+        },
+        {
+            {"a"}, {"b"}, {"c"}, {"p"}, {"q"}, {"r"}, {"s"}, {"t"}
+        }
+    };
+
+    Operators ops = {
+            {"!", {5, NOT_ASSOCIATIVE, UNARY, OP_NOT}},
+            {"*", {4, ASSOCIATIVE, BINARY, OP_AND}},
+            {"^", {3, ASSOCIATIVE, BINARY, OP_XOR}},
+            {"+", {2, ASSOCIATIVE, BINARY, OP_OR}},
+            {"=>", {1, NOT_ASSOCIATIVE, BINARY, OP_IMPLIES}},
+            {"<=>", {0, NOT_ASSOCIATIVE, BINARY, OP_IFF}}
+    };
+
+    const std::vector<std::string> variables = {"a", "b", "c", "p", "q", "r", "s", "t"};
+    std::mt19937 rng(2024);
+    Serializer serializer(ops);
+    std::cout << "Serializer benchmark, " << nodes << " nodes, " << std::thread::hardware_concurrency()
+              << " hardware threads" << std::endl;
+
+    bool identical = benchmark("Random WFF", AST(symbols, ops, randomTree(rng, nodes, ops, variables)), serializer);
+    // A clause has 3 variables, 2 ORs and on average 1.5 NOTs, plus one AND joining it to the rest
+    identical = benchmark("CNF", AST(symbols, ops, randomCnf(rng, nodes * 2 / 17, ops, variables)), serializer)
+                && identical;
+
+    if (!identical)
+    {
+        std::cerr << "toStringParallel() disagrees with toString()" << std::endl;
+        return 1;
+    }
+    return 0;
+}
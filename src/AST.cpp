@@ -3,6 +3,7 @@
 //
 
 #include "AST.hpp"
+#include "Serializer.hpp"
 
 #include <utility>
 
@@ -11,16 +12,38 @@ AST::AST(Symbols _symbols, Operators _ops, const std::string& expression)
       symbols(std::move(_symbols))
 {
     std::vector<Token> tokens = tokenizeWff(expression); // Tokenize
-    tokens = shuntingYard(tokens); // Translate from infix to postfix
-    insertNodes(root, tokens); // Generate an AST from the tokens
+    size_t token_bytes = tokenBytes(tokens);
+    MemoryStats::allocated(ALLOC_TOKENS, token_bytes);
+
+    std::vector<Token> postfix = shuntingYard(tokens); // Translate from infix to postfix
+    size_t postfix_bytes = tokenBytes(postfix);
+    MemoryStats::allocated(ALLOC_TOKENS, postfix_bytes);
+
+    insertNodes(root, postfix); // Generate an AST from the tokens
+
+    MemoryStats::released(ALLOC_TOKENS, token_bytes + postfix_bytes);
 }
 
+AST::AST(Symbols _symbols, Operators _ops, AST_node* _root)
+    : root(_root),
+      symbols(std::move(_symbols)),
+      ops(std::move(_ops))
+    {}
+
 AST::AST(const AST& other)
     : root(deep_copy(other.root)),
       symbols(other.symbols),
       ops(other.ops)
     {}
 
+AST::AST(AST&& other)
+    : root(other.root),
+      symbols(other.symbols),
+      ops(other.ops)
+{
+    other.root = nullptr;
+}
+
 AST::~AST()
 {
     deleteTree(root);
@@ -31,6 +54,11 @@ const AST_node* AST::getRoot() const
     return root;
 }
 
+AST_node*& AST::getMutableRoot()
+{
+    return root;
+}
+
 AST_node* AST::findMutableNode(AST_node* curr, const AST_node* target)
 {
     if (curr == target)
@@ -57,59 +85,18 @@ bool AST::replaceNode(const AST_node* node, const AST_node* new_node)
         {
             deleteTree(child);
         }
-        *mut_node = *deep_copy(new_node);
+        AST_node* copy = deep_copy(new_node);
+        mut_node->token = copy->token;
+        mut_node->children.swap(copy->children);
+        delete copy; // Only the shell is deleted, its children now belong to mut_node
         return true;
     }
     return false;
 }
 
-void AST::traverseAndPrint(std::ostream& os, const AST_node* curr) const
-{
-    // Print unary operators before their operands
-    if (curr->token.type == OPERATOR && ops.getProperties(curr->token.lexeme).arity == UNARY)
-    {
-        os << curr->token.lexeme;
-    }
-
-    // Print identifiers (identifiers have no children so this is the end of a tree)
-    if (curr->token.type == VARIABLE || curr->token.type == CONSTANT)
-    {
-        os << curr->token.lexeme;
-    }
-
-    // traverse down and print
-    bool already_printed = false;
-    for (const AST_node* child : curr->children)
-    {
-        bool opened_paren = false;
-        if (curr->token.type == OPERATOR
-            && child->token.type == OPERATOR
-            && ops.getProperties(child->token.lexeme).arity != UNARY
-            && (curr->token.lexeme != child->token.lexeme
-                || ops.getProperties(child->token.lexeme).associativity == NOT_ASSOCIATIVE))
-        {
-            opened_paren = true;
-            os << "(";
-        }
-        traverseAndPrint(os, child);
-        if (opened_paren)
-        {
-            os << ")";
-        }
-        if (!already_printed && curr->token.type == OPERATOR && ops.getProperties(curr->token.lexeme).arity == BINARY)
-        {
-            already_printed = true;
-            os << curr->token.lexeme;
-        }
-
-    }
-}
-
 std::string AST::toString() const
 {
-    std::stringstream ss;
-    traverseAndPrint(ss, root);
-    return ss.str();
+    return Serializer(ops).toString(root);
 }
 
 std::vector<Token> AST::tokenizeWff(const std::string& formula) const
@@ -258,6 +245,16 @@ void AST::insertNodes(AST_node*& curr, const std::vector<Token>& tokens) const
     node_stack.pop();
 }
 
+size_t AST::tokenBytes(const std::vector<Token>& tokens)
+{
+    size_t bytes = tokens.capacity() * sizeof(Token);
+    for (const Token& token : tokens)
+    {
+        bytes += token.lexeme.capacity();
+    }
+    return bytes;
+}
+
 void AST::deleteTree(AST_node* curr)
 {
     if (curr)
@@ -5,12 +5,12 @@
 #ifndef WFF2CNF_AST_HPP
 #define WFF2CNF_AST_HPP
 
+#include "MemoryStats.hpp"
 #include "Symbols.hpp"
 #include "Operators.hpp"
 #include "Token.hpp"
 #include <stack>
 #include <string>
-#include <sstream>
 #include <vector>
 
 struct AST_node
@@ -19,7 +19,10 @@ struct AST_node
     std::vector<AST_node*> children; // Variable number of children in order to deal w/ binary operators,
                                      // unary operators, and identifiers (which have no children).
                                      // Basically a node can have [0-2] children.
-    AST_node(const Token& _token) : token(_token) {}
+    AST_node(const Token& _token) : token(_token) { MemoryStats::nodeCreated(); }
+    AST_node(const AST_node& other) : token(other.token), children(other.children) { MemoryStats::nodeCreated(); }
+    AST_node& operator=(const AST_node&) = default;
+    ~AST_node() { MemoryStats::nodeFreed(); }
 };
 
 AST_node* deep_copy(const AST_node*);
@@ -35,18 +38,22 @@ private:
     std::vector<Token> tokenizeWff(const std::string&) const;
     std::vector<Token> shuntingYard(const std::vector<Token>&) const;
     void insertNodes(AST_node*&, const std::vector<Token>&) const;
-    static void deleteTree(AST_node*);
+    static size_t tokenBytes(const std::vector<Token>&);
     static AST_node* findMutableNode(AST_node*, const AST_node*);
-    void traverseAndPrint(std::ostream&, const AST_node*) const;
 
 public:
     AST(Symbols, Operators, const std::string&);
+    AST(Symbols, Operators, AST_node*); // Takes ownership of an already built tree
     AST(const AST&);
+    AST(AST&&);
     ~AST();
 
     const AST_node* getRoot() const;
+    AST_node*& getMutableRoot(); // For passes that rewrite the tree in place rather than through replaceNode
     bool replaceNode(const AST_node*, const AST_node*);
     std::string toString() const;
+
+    static void deleteTree(AST_node*);
 };
 
 #endif //WFF2CNF_AST_HPP
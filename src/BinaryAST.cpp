@@ -0,0 +1,407 @@
+#include "BinaryAST.hpp"
+
+#include <array>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char MAGIC[4] = {'W', 'F', 'F', 'B'};
+static const int NUM_OPERATOR_KINDS = OP_IFF + 1;
+
+struct BinaryAST::Writer
+{
+    const BinaryAST& format;
+    const bool share_subtrees;
+    std::string body;
+    uint64_t num_records = 0;
+    std::vector<std::string> symbol_table;
+    std::unordered_map<std::string,uint64_t> symbol_ids;
+
+    // Only used with FLAG_SHARED_SUBTREES: every distinct subtree gets a canonical id (hash-consing on the opcode and
+    // the canonical ids of its children), and the record index where that subtree was first written
+    std::map<std::array<uint64_t,3>,uint64_t> canonical_ids;
+    std::unordered_map<const AST_node*,uint64_t> node_ids;
+    std::vector<int64_t> first_record;
+
+    Writer(const BinaryAST& _format, const bool _share_subtrees) : format(_format), share_subtrees(_share_subtrees) {}
+
+    uint8_t opcodeOf(const AST_node* curr) const
+    {
+        if (curr->token.type == VARIABLE)
+        {
+            return OPC_VARIABLE;
+        }
+        if (curr->token.type == CONSTANT)
+        {
+            return format.symbols.getConstValue(curr->token.lexeme) == CONST_TRUE ? OPC_TRUE : OPC_FALSE;
+        }
+        return OPC_OPERATOR + format.ops.getProperties(curr->token.lexeme).kind;
+    }
+
+    uint64_t symbolId(const std::string& lexeme)
+    {
+        auto it = symbol_ids.find(lexeme);
+        if (it != symbol_ids.end())
+        {
+            return it->second;
+        }
+        symbol_table.push_back(lexeme);
+        symbol_ids.insert({lexeme, symbol_table.size() - 1});
+        return symbol_table.size() - 1;
+    }
+
+    uint64_t assignCanonicalIds(const AST_node* curr)
+    {
+        std::array<uint64_t,3> key = {opcodeOf(curr), 0, 0};
+        if (curr->token.type == VARIABLE)
+        {
+            key[1] = symbolId(curr->token.lexeme);
+        }
+        for (size_t i=0; i<curr->children.size(); i++)
+        {
+            key[i + 1] = assignCanonicalIds(curr->children[i]);
+        }
+
+        auto inserted = canonical_ids.insert({key, canonical_ids.size()});
+        node_ids[curr] = inserted.first->second;
+        return inserted.first->second;
+    }
+
+    void write(const AST_node* curr)
+    {
+        int64_t* shared = nullptr;
+        if (share_subtrees && curr->token.type == OPERATOR)
+        {
+            shared = &first_record[node_ids.at(curr)];
+            if (*shared >= 0)
+            {
+                body += static_cast<char>(OPC_REFERENCE);
+                writeVarint(body, *shared);
+                num_records++;
+                return;
+            }
+        }
+
+        for (const AST_node* child : curr->children)
+        {
+            write(child);
+        }
+
+        uint8_t opcode = opcodeOf(curr);
+        body += static_cast<char>(opcode);
+        if (opcode == OPC_VARIABLE)
+        {
+            writeVarint(body, symbolId(curr->token.lexeme));
+        }
+        if (shared)
+        {
+            *shared = num_records;
+        }
+        num_records++;
+    }
+};
+
+struct BinaryAST::Reader
+{
+    const BinaryAST& format;
+    const uint8_t* pos;
+    const uint8_t* end;
+    std::array<const std::string*,NUM_OPERATOR_KINDS> lexemes = {}; // Filled on first use, not every kind has to exist
+
+    Reader(const BinaryAST& _format, const char* data, const size_t size)
+        : format(_format),
+          pos(reinterpret_cast<const uint8_t*>(data)),
+          end(reinterpret_cast<const uint8_t*>(data) + size)
+        {}
+
+    uint8_t readByte()
+    {
+        if (pos == end)
+        {
+            throw std::runtime_error("Unexpected end of data in BinaryAST.deserialize()");
+        }
+        return *pos++;
+    }
+
+    const std::string& operatorLexeme(const int kind)
+    {
+        if (!lexemes[kind])
+        {
+            lexemes[kind] = &format.ops.getLexeme(static_cast<OperatorKind>(kind));
+        }
+        return *lexemes[kind];
+    }
+
+    AST_node* read()
+    {
+        for (const char c : MAGIC)
+        {
+            if (readByte() != static_cast<uint8_t>(c))
+            {
+                throw std::runtime_error("Bad magic number in BinaryAST.deserialize()");
+            }
+        }
+        if (readByte() != FORMAT_VERSION)
+        {
+            throw std::runtime_error("Unsupported format version in BinaryAST.deserialize()");
+        }
+        const bool share_subtrees = (readByte() & FLAG_SHARED_SUBTREES) != 0;
+
+        // Counts come from the data, so check them against the bytes left before allocating anything for them. Every
+        // symbol and every record takes at least one byte.
+        const uint64_t num_symbols = readVarint(pos, end);
+        if (num_symbols > static_cast<uint64_t>(end - pos))
+        {
+            throw std::runtime_error("Symbol count runs past the end of data in BinaryAST.deserialize()");
+        }
+        std::vector<std::string> symbol_table(num_symbols);
+        for (std::string& symbol : symbol_table)
+        {
+            uint64_t length = readVarint(pos, end);
+            if (length > static_cast<uint64_t>(end - pos))
+            {
+                throw std::runtime_error("Symbol runs past the end of data in BinaryAST.deserialize()");
+            }
+            symbol.assign(reinterpret_cast<const char*>(pos), length);
+            pos += length;
+
+            // Like the parser, only accept declared variables. That also keeps out names such as the "_t" aux
+            // variables, which the ParityEncoder relies on never meeting in its input.
+            if (!format.symbols.isVariable(symbol))
+            {
+                throw std::runtime_error("Undeclared variable '" + symbol + "' in BinaryAST.deserialize()");
+            }
+        }
+
+        const uint64_t num_records = readVarint(pos, end);
+        if (num_records > static_cast<uint64_t>(end - pos))
+        {
+            throw std::runtime_error("Record count runs past the end of data in BinaryAST.deserialize()");
+        }
+        std::vector<AST_node*> records; // Subtree built by each record, only kept when references are possible
+        std::vector<uint64_t> record_sizes; // Node count of each of those subtrees
+        std::vector<AST_node*> node_stack;
+        std::vector<uint64_t> size_stack; // Node count of each subtree on node_stack
+        node_stack.reserve(64);
+        size_stack.reserve(64);
+        if (share_subtrees)
+        {
+            records.reserve(num_records);
+            record_sizes.reserve(num_records);
+        }
+        uint64_t num_nodes = 0;
+
+        try
+        {
+            for (uint64_t r=0; r<num_records; r++)
+            {
+                uint8_t opcode = readByte();
+                AST_node* new_node = nullptr;
+                uint64_t new_size = 1;
+
+                if (opcode == OPC_VARIABLE)
+                {
+                    uint64_t id = readVarint(pos, end);
+                    if (id >= symbol_table.size())
+                    {
+                        throw std::runtime_error("Symbol id out of range in BinaryAST.deserialize()");
+                    }
+                    new_node = new AST_node(Token(VARIABLE, symbol_table[id]));
+                }
+                else if (opcode == OPC_FALSE || opcode == OPC_TRUE)
+                {
+                    const ConstantValue value = opcode == OPC_TRUE ? CONST_TRUE : CONST_FALSE;
+                    new_node = new AST_node(Token(CONSTANT, format.symbols.getConstLexeme(value)));
+                }
+                else if (opcode == OPC_REFERENCE)
+                {
+                    uint64_t index = readVarint(pos, end);
+                    if (!share_subtrees || index >= records.size())
+                    {
+                        throw std::runtime_error("Invalid subtree reference in BinaryAST.deserialize()");
+                    }
+                    // References to references double the tree with every record, so check before copying
+                    new_size = record_sizes[index];
+                    if (new_size > MAX_NODES - num_nodes)
+                    {
+                        throw std::runtime_error("Tree exceeds " + std::to_string(MAX_NODES)
+                                                 + " nodes in BinaryAST.deserialize()");
+                    }
+                    new_node = deep_copy(records[index]);
+                }
+                else if (opcode < OPC_OPERATOR + NUM_OPERATOR_KINDS)
+                {
+                    const std::string& lexeme = operatorLexeme(opcode - OPC_OPERATOR);
+                    size_t num_children = format.ops.getNumOperands(lexeme);
+                    if (node_stack.size() < num_children)
+                    {
+                        throw std::runtime_error("Operator is missing operands in BinaryAST.deserialize()");
+                    }
+                    new_node = new AST_node(Token(OPERATOR, lexeme));
+                    new_node->children.assign(node_stack.end() - num_children, node_stack.end());
+                    node_stack.resize(node_stack.size() - num_children);
+                    for (size_t i=0; i<num_children; i++)
+                    {
+                        new_size += size_stack.back();
+                        size_stack.pop_back();
+                    }
+                }
+                else
+                {
+                    throw std::runtime_error("Unknown opcode in BinaryAST.deserialize()");
+                }
+
+                num_nodes += opcode == OPC_REFERENCE ? new_size : 1; // Only a reference creates more than one node
+                node_stack.push_back(new_node);
+                size_stack.push_back(new_size);
+                if (share_subtrees)
+                {
+                    records.push_back(new_node);
+                    record_sizes.push_back(new_size);
+                }
+            }
+
+            if (node_stack.size() != 1)
+            {
+                throw std::runtime_error("Records do not form a single tree in BinaryAST.deserialize()");
+            }
+        }
+        catch (...)
+        {
+            for (AST_node* node : node_stack)
+            {
+                AST::deleteTree(node);
+            }
+            throw;
+        }
+
+        return node_stack.back();
+    }
+};
+
+BinaryAST::BinaryAST(const Symbols& _symbols, const Operators& _ops)
+    : symbols(_symbols),
+      ops(_ops)
+    {}
+
+std::string BinaryAST::serialize(const AST& wff, const uint8_t flags) const
+{
+    Writer writer(*this, (flags & FLAG_SHARED_SUBTREES) != 0);
+    if (writer.share_subtrees)
+    {
+        writer.assignCanonicalIds(wff.getRoot());
+        writer.first_record.assign(writer.canonical_ids.size(), -1);
+        writer.canonical_ids.clear();
+    }
+    writer.write(wff.getRoot());
+
+    std::string out(MAGIC, sizeof(MAGIC));
+    out += static_cast<char>(FORMAT_VERSION);
+    out += static_cast<char>(flags);
+    writeVarint(out, writer.symbol_table.size());
+    for (const std::string& symbol : writer.symbol_table)
+    {
+        writeVarint(out, symbol.size());
+        out += symbol;
+    }
+    writeVarint(out, writer.num_records);
+    out += writer.body;
+    return out;
+}
+
+AST BinaryAST::deserialize(const char* data, const size_t size) const
+{
+    Reader reader(*this, data, size);
+    return AST(symbols, ops, reader.read());
+}
+
+void BinaryAST::writeFile(const std::string& path, const AST& wff, const uint8_t flags) const
+{
+    std::ofstream file(path, std::ios::binary);
+    std::string data = serialize(wff, flags);
+    file.write(data.data(), data.size());
+    if (!file)
+    {
+        throw std::runtime_error("Could not write '" + path + "' in BinaryAST.writeFile()");
+    }
+}
+
+AST BinaryAST::readFile(const std::string& path) const
+{
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        throw std::runtime_error("Could not open '" + path + "' in BinaryAST.readFile()");
+    }
+
+    size_t size = info.st_size;
+    void* data = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd); // The mapping stays valid after the descriptor is closed
+    if (data == MAP_FAILED)
+    {
+        throw std::runtime_error("Could not map '" + path + "' in BinaryAST.readFile()");
+    }
+
+    try
+    {
+        AST wff = deserialize(static_cast<const char*>(data), size);
+        munmap(data, size);
+        return wff;
+    }
+    catch (...)
+    {
+        munmap(data, size);
+        throw;
+    }
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Could not open '" + path + "' in BinaryAST.readFile()");
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return deserialize(data.data(), data.size());
+#endif
+}
+
+void BinaryAST::writeVarint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+uint64_t BinaryAST::readVarint(const uint8_t*& pos, const uint8_t* end)
+{
+    uint64_t value = 0;
+    for (int shift=0; shift<64; shift+=7)
+    {
+        if (pos == end)
+        {
+            throw std::runtime_error("Unexpected end of data in BinaryAST.readVarint()");
+        }
+        uint8_t byte = *pos++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return value;
+        }
+    }
+    throw std::runtime_error("Varint is too long in BinaryAST.readVarint()");
+}
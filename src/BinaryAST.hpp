@@ -0,0 +1,64 @@
+#ifndef WFF2CNF_BINARYAST_HPP
+#define WFF2CNF_BINARYAST_HPP
+
+#include "AST.hpp"
+#include "Operators.hpp"
+#include "Symbols.hpp"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// BinaryAST converts an AST to and from a compact binary format, so pipeline stages can hand formulas to each other
+// without printing and reparsing infix text.
+//
+// Layout (all integers are unsigned LEB128 varints):
+//   header       "WFFB", version byte, flags byte (FLAG_SHARED_SUBTREES)
+//   symbol table count, then for each variable: length, bytes
+//   node count   number of records that follow
+//   records      post-order opcode stream:
+//                  OPC_VARIABLE <symbol id>
+//                  OPC_FALSE / OPC_TRUE
+//                  OPC_OPERATOR + OperatorKind (pops its operands)
+//                  OPC_REFERENCE <record index> (a copy of an earlier operator subtree, only with FLAG_SHARED_SUBTREES)
+//
+// Operators and constants are stored by meaning rather than by lexeme, so the reader only needs its own Symbols and
+// Operators to rebuild the tokens. Variables are stored by name, and the reader rejects any its Symbols don't declare,
+// so a CNF holding ParityEncoder aux variables can be written but not read back.
+class BinaryAST
+{
+private:
+    enum Opcode : uint8_t
+    {
+        OPC_VARIABLE,
+        OPC_FALSE,
+        OPC_TRUE,
+        OPC_REFERENCE,
+        OPC_OPERATOR // Followed by OPC_OPERATOR + OperatorKind for every kind
+    };
+
+    static const uint8_t FORMAT_VERSION = 1;
+
+    const Symbols symbols;
+    const Operators ops;
+
+    struct Writer;
+    struct Reader;
+
+    static void writeVarint(std::string&, uint64_t);
+    static uint64_t readVarint(const uint8_t*&, const uint8_t*);
+
+public:
+    static const uint8_t FLAG_SHARED_SUBTREES = 1;
+    static const uint64_t MAX_NODES = uint64_t(1) << 24; // deserialize() rejects data that expands to a larger tree
+
+    BinaryAST(const Symbols&, const Operators&);
+
+    std::string serialize(const AST&, uint8_t flags = 0) const;
+    AST deserialize(const char*, size_t) const;
+
+    void writeFile(const std::string&, const AST&, uint8_t flags = 0) const;
+    AST readFile(const std::string&) const; // Memory-maps the file where the platform supports it
+};
+
+#endif //WFF2CNF_BINARYAST_HPP
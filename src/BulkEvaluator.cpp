@@ -0,0 +1,336 @@
+#include "BulkEvaluator.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define WFF2CNF_BULK_VECTOR
+typedef __m256i Vector;
+static const size_t LANES = 4;
+static Vector load(const uint64_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+static void store(uint64_t* p, Vector v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+static Vector bitAnd(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+static Vector bitOr(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+static Vector bitXor(Vector a, Vector b) { return _mm256_xor_si256(a, b); }
+static Vector bitNot(Vector a) { return _mm256_xor_si256(a, _mm256_set1_epi64x(-1)); }
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define WFF2CNF_BULK_VECTOR
+typedef __m128i Vector;
+static const size_t LANES = 2;
+static Vector load(const uint64_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+static void store(uint64_t* p, Vector v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+static Vector bitAnd(Vector a, Vector b) { return _mm_and_si128(a, b); }
+static Vector bitOr(Vector a, Vector b) { return _mm_or_si128(a, b); }
+static Vector bitXor(Vector a, Vector b) { return _mm_xor_si128(a, b); }
+static Vector bitNot(Vector a) { return _mm_xor_si128(a, _mm_set1_epi32(-1)); }
+#endif
+
+static uint64_t bitAnd(uint64_t a, uint64_t b) { return a & b; }
+static uint64_t bitOr(uint64_t a, uint64_t b) { return a | b; }
+static uint64_t bitXor(uint64_t a, uint64_t b) { return a ^ b; }
+static uint64_t bitNot(uint64_t a) { return ~a; }
+
+// Each kernel combines the value on the stack (a) with the operand (b), for plain words and vectors alike
+struct CopyKernel     { template<typename T> static T apply(T, T b) { return b; } };
+struct AndKernel      { template<typename T> static T apply(T a, T b) { return bitAnd(a, b); } };
+struct OrKernel       { template<typename T> static T apply(T a, T b) { return bitOr(a, b); } };
+struct XorKernel      { template<typename T> static T apply(T a, T b) { return bitXor(a, b); } };
+struct IffKernel      { template<typename T> static T apply(T a, T b) { return bitNot(bitXor(a, b)); } };
+struct ImpliesKernel  { template<typename T> static T apply(T a, T b) { return bitOr(bitNot(a), b); } };
+struct ConverseKernel { template<typename T> static T apply(T a, T b) { return bitOr(a, bitNot(b)); } };
+
+template<typename Kernel, bool NEGATE>
+static void applyKernel(uint64_t* a, const uint64_t* b, const size_t words)
+{
+    size_t w = 0;
+#ifdef WFF2CNF_BULK_VECTOR
+    for (; w + LANES <= words; w += LANES)
+    {
+        Vector operand = load(b + w);
+        store(a + w, Kernel::apply(load(a + w), NEGATE ? bitNot(operand) : operand));
+    }
+#endif
+    for (; w < words; w++)
+    {
+        a[w] = Kernel::apply(a[w], NEGATE ? ~b[w] : b[w]);
+    }
+}
+
+const size_t BulkEvaluator::BLOCK_WORDS;
+
+BulkEvaluator::BulkEvaluator(const Symbols& _symbols, const Operators& _ops, const AST& wff)
+    : symbols(_symbols),
+      ops(_ops)
+{
+    std::unordered_map<const AST_node*,size_t> needs;
+    stack_depth = computeNeeds(wff.getRoot(), needs);
+    compileNode(wff.getRoot(), needs);
+}
+
+const std::vector<std::string>& BulkEvaluator::getVariables() const
+{
+    return variables;
+}
+
+uint32_t BulkEvaluator::getVariableIndex(const std::string& name) const
+{
+    auto it = variable_ids.find(name);
+    if (it == variable_ids.end())
+    {
+        throw std::runtime_error("Variable '" + name + "' does not occur in the WFF in BulkEvaluator.getVariableIndex()");
+    }
+    return it->second;
+}
+
+size_t BulkEvaluator::getTapeLength() const
+{
+    return tape.size();
+}
+
+const char* BulkEvaluator::getKernelName()
+{
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSE2__)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+bool BulkEvaluator::isLiteral(const AST_node* curr) const
+{
+    return curr->children.empty() || (curr->children.size() == 1 && curr->children[0]->children.empty());
+}
+
+BulkEvaluator::Instruction BulkEvaluator::literal(const Opcode opcode, const AST_node* curr) const
+{
+    bool negated = curr->token.type == OPERATOR;
+    const AST_node* leaf = negated ? curr->children[0] : curr;
+    if (leaf->token.type == CONSTANT)
+    {
+        bool value = (symbols.getConstValue(leaf->token.lexeme) == CONST_TRUE) != negated;
+        return {opcode, value ? SOURCE_TRUE : SOURCE_FALSE, 0};
+    }
+    return {opcode, negated ? SOURCE_NEGATED_VARIABLE : SOURCE_VARIABLE, variable_ids.at(leaf->token.lexeme)};
+}
+
+size_t BulkEvaluator::computeNeeds(const AST_node* curr, std::unordered_map<const AST_node*,size_t>& needs)
+{
+    // Sethi-Ullman numbers: the stack slots a subtree needs when its costlier operand is always evaluated first.
+    // This pass also numbers the variables in the order they appear.
+    if (isLiteral(curr))
+    {
+        const AST_node* leaf = curr->children.empty() ? curr : curr->children[0];
+        if (leaf->token.type == VARIABLE && variable_ids.insert({leaf->token.lexeme, variables.size()}).second)
+        {
+            variables.push_back(leaf->token.lexeme);
+        }
+        return 1;
+    }
+
+    size_t need;
+    if (curr->children.size() == 1)
+    {
+        need = computeNeeds(curr->children[0], needs);
+    }
+    else
+    {
+        size_t left = computeNeeds(curr->children[0], needs);
+        size_t right = computeNeeds(curr->children[1], needs);
+        if (isLiteral(curr->children[1]))
+        {
+            need = left; // The literal is read straight from its column
+        }
+        else if (isLiteral(curr->children[0]))
+        {
+            need = right;
+        }
+        else
+        {
+            need = left == right ? left + 1 : std::max(left, right);
+        }
+    }
+    needs[curr] = need;
+    return need;
+}
+
+void BulkEvaluator::compileNode(const AST_node* curr, const std::unordered_map<const AST_node*,size_t>& needs)
+{
+    if (isLiteral(curr))
+    {
+        tape.push_back(literal(PUSH, curr));
+        return;
+    }
+
+    const OperatorKind kind = ops.getProperties(curr->token.lexeme).kind;
+    if (kind == OP_NOT)
+    {
+        compileNode(curr->children[0], needs);
+        tape.push_back({NOT, SOURCE_STACK, 0});
+        return;
+    }
+
+    Opcode opcode;
+    switch (kind)
+    {
+        case OP_AND:     opcode = AND; break;
+        case OP_OR:      opcode = OR; break;
+        case OP_XOR:     opcode = XOR; break;
+        case OP_IFF:     opcode = IFF; break;
+        case OP_IMPLIES: opcode = IMPLIES; break;
+        default: throw std::runtime_error("Unsupported operator " + curr->token.lexeme + " in BulkEvaluator()");
+    }
+
+    const AST_node* left = curr->children[0];
+    const AST_node* right = curr->children[1];
+    bool right_first;
+    if (isLiteral(right))
+    {
+        right_first = false;
+    }
+    else if (isLiteral(left))
+    {
+        right_first = true;
+    }
+    else
+    {
+        right_first = needs.at(right) > needs.at(left);
+    }
+    if (right_first)
+    {
+        std::swap(left, right);
+        opcode = opcode == IMPLIES ? CONVERSE_IMPLIES : opcode;
+    }
+
+    compileNode(left, needs);
+    if (isLiteral(right))
+    {
+        tape.push_back(literal(opcode, right));
+    }
+    else
+    {
+        compileNode(right, needs);
+        tape.push_back({opcode, SOURCE_STACK, 0});
+    }
+}
+
+template<bool NEGATE>
+void BulkEvaluator::runKernel(const Opcode opcode, uint64_t* a, const uint64_t* b, const size_t words)
+{
+    switch (opcode)
+    {
+        case PUSH:             applyKernel<CopyKernel,NEGATE>(a, b, words); break;
+        case NOT:              applyKernel<CopyKernel,!NEGATE>(a, b, words); break;
+        case AND:              applyKernel<AndKernel,NEGATE>(a, b, words); break;
+        case OR:               applyKernel<OrKernel,NEGATE>(a, b, words); break;
+        case XOR:              applyKernel<XorKernel,NEGATE>(a, b, words); break;
+        case IFF:              applyKernel<IffKernel,NEGATE>(a, b, words); break;
+        case IMPLIES:          applyKernel<ImpliesKernel,NEGATE>(a, b, words); break;
+        case CONVERSE_IMPLIES: applyKernel<ConverseKernel,NEGATE>(a, b, words); break;
+    }
+}
+
+void BulkEvaluator::evaluateBlock(const std::vector<const uint64_t*>& columns,
+                                  const size_t first_word,
+                                  const size_t words,
+                                  uint64_t* stack,
+                                  uint64_t* satisfying) const
+{
+    const uint64_t* ones = stack + stack_depth * BLOCK_WORDS;
+    size_t top = 0;
+    for (const Instruction& instruction : tape)
+    {
+        if (instruction.opcode == NOT)
+        {
+            uint64_t* slot = stack + (top - 1) * BLOCK_WORDS;
+            runKernel<false>(NOT, slot, slot, words);
+            continue;
+        }
+
+        const uint64_t* operand = nullptr;
+        bool negate = false;
+        switch (instruction.source)
+        {
+            case SOURCE_STACK:            operand = stack + --top * BLOCK_WORDS; break;
+            case SOURCE_VARIABLE:         operand = columns[instruction.variable] + first_word; break;
+            case SOURCE_NEGATED_VARIABLE: operand = columns[instruction.variable] + first_word; negate = true; break;
+            case SOURCE_TRUE:             operand = ones; break;
+            case SOURCE_FALSE:            operand = ones; negate = true; break;
+        }
+
+        uint64_t* slot = stack + (instruction.opcode == PUSH ? top++ : top - 1) * BLOCK_WORDS;
+        if (negate)
+        {
+            runKernel<true>(instruction.opcode, slot, operand, words);
+        }
+        else
+        {
+            runKernel<false>(instruction.opcode, slot, operand, words);
+        }
+    }
+    std::memcpy(satisfying, stack, words * sizeof(uint64_t));
+}
+
+void BulkEvaluator::evaluate(const std::vector<const uint64_t*>& columns,
+                             const size_t num_assignments,
+                             uint64_t* satisfying) const
+{
+    if (columns.size() != variables.size())
+    {
+        throw std::runtime_error("Expected " + std::to_string(variables.size()) + " columns but got "
+                                 + std::to_string(columns.size()) + " in BulkEvaluator.evaluate()");
+    }
+
+    // One block per stack slot, plus a block of ones that constants are read from
+    std::vector<uint64_t> stack((stack_depth + 1) * BLOCK_WORDS);
+    std::fill(stack.end() - BLOCK_WORDS, stack.end(), ~0ULL);
+
+    const size_t words = (num_assignments + 63) / 64;
+    for (size_t first_word = 0; first_word < words; first_word += BLOCK_WORDS)
+    {
+        evaluateBlock(columns, first_word, std::min(BLOCK_WORDS, words - first_word), stack.data(),
+                      satisfying + first_word);
+    }
+    if (num_assignments % 64 != 0)
+    {
+        satisfying[words - 1] &= (1ULL << (num_assignments % 64)) - 1;
+    }
+}
+
+std::vector<uint64_t> BulkEvaluator::satisfying(const std::vector<const uint64_t*>& columns,
+                                                const size_t num_assignments) const
+{
+    std::vector<uint64_t> result((num_assignments + 63) / 64);
+    evaluate(columns, num_assignments, result.data());
+    return result;
+}
+
+std::vector<uint64_t> BulkEvaluator::unsatisfying(const std::vector<const uint64_t*>& columns,
+                                                  const size_t num_assignments) const
+{
+    std::vector<uint64_t> result = satisfying(columns, num_assignments);
+    for (uint64_t& word : result)
+    {
+        word = ~word;
+    }
+    if (num_assignments % 64 != 0)
+    {
+        result.back() &= (1ULL << (num_assignments % 64)) - 1;
+    }
+    return result;
+}
+
+size_t BulkEvaluator::countSatisfying(const std::vector<const uint64_t*>& columns, const size_t num_assignments) const
+{
+    size_t count = 0;
+    for (uint64_t word : satisfying(columns, num_assignments))
+    {
+        count += std::bitset<64>(word).count();
+    }
+    return count;
+}
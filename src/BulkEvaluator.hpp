@@ -0,0 +1,85 @@
+#ifndef WFF2CNF_BULKEVALUATOR_HPP
+#define WFF2CNF_BULKEVALUATOR_HPP
+
+#include "AST.hpp"
+#include "Operators.hpp"
+#include "Symbols.hpp"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// BulkEvaluator compiles a WFF once and then evaluates it on many assignments at a time.
+//
+// Assignments are given bit-packed by variable: columns[i] holds one bit per assignment for the i-th variable of
+// getVariables(), 64 assignments per word, and the result is packed the same way. The WFF is compiled into a linear
+// tape for a stack machine whose slots are blocks of BLOCK_WORDS words, so every instruction runs a tight loop over a
+// block that stays in L1. Subtrees are ordered by Sethi-Ullman number and literal operands are read straight from
+// their column, which keeps the stack only O(log n) slots deep and halves the traffic for CNFs.
+//
+// The loops use AVX2 when the build targets it (e.g. -march=native), SSE2 otherwise on x86-64, and plain 64-bit words
+// everywhere else.
+class BulkEvaluator
+{
+private:
+    enum Opcode : uint8_t
+    {
+        PUSH,
+        NOT,
+        AND,
+        OR,
+        XOR,
+        IFF,
+        IMPLIES,
+        CONVERSE_IMPLIES // Operands in reverse order: top of the stack is the antecedent
+    };
+
+    enum Source : uint8_t
+    {
+        SOURCE_STACK,
+        SOURCE_VARIABLE,
+        SOURCE_NEGATED_VARIABLE,
+        SOURCE_TRUE,
+        SOURCE_FALSE
+    };
+
+    struct Instruction
+    {
+        Opcode opcode;
+        Source source; // Where the (second) operand comes from
+        uint32_t variable; // For SOURCE_VARIABLE and SOURCE_NEGATED_VARIABLE
+    };
+
+    static const size_t BLOCK_WORDS = 64;
+
+    const Symbols symbols;
+    const Operators ops;
+    std::vector<Instruction> tape;
+    std::vector<std::string> variables;
+    std::unordered_map<std::string,uint32_t> variable_ids;
+    size_t stack_depth = 0;
+
+    bool isLiteral(const AST_node*) const;
+    Instruction literal(Opcode, const AST_node*) const;
+    size_t computeNeeds(const AST_node*, std::unordered_map<const AST_node*,size_t>&);
+    void compileNode(const AST_node*, const std::unordered_map<const AST_node*,size_t>&);
+    template<bool NEGATE>
+    static void runKernel(Opcode, uint64_t*, const uint64_t*, size_t);
+    void evaluateBlock(const std::vector<const uint64_t*>&, size_t, size_t, uint64_t*, uint64_t*) const;
+
+public:
+    BulkEvaluator(const Symbols&, const Operators&, const AST&);
+
+    const std::vector<std::string>& getVariables() const;
+    uint32_t getVariableIndex(const std::string&) const;
+    size_t getTapeLength() const;
+    static const char* getKernelName(); // "avx2", "sse2" or "scalar"
+
+    // satisfying must hold (num_assignments + 63) / 64 words, bits past num_assignments are cleared
+    void evaluate(const std::vector<const uint64_t*>& columns, size_t num_assignments, uint64_t* satisfying) const;
+    std::vector<uint64_t> satisfying(const std::vector<const uint64_t*>&, size_t) const;
+    std::vector<uint64_t> unsatisfying(const std::vector<const uint64_t*>&, size_t) const;
+    size_t countSatisfying(const std::vector<const uint64_t*>&, size_t) const;
+};
+
+#endif //WFF2CNF_BULKEVALUATOR_HPP
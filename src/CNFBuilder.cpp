@@ -0,0 +1,165 @@
+#include "CNFBuilder.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+
+CNFBuilder::CNFBuilder(const Symbols& _symbols, const Operators& _ops, const Transformer& _transformer)
+    : symbols(_symbols),
+      ops(_ops),
+      transformer(_transformer),
+      simplifier(_symbols, _ops),
+      parity_encoder(_symbols, _ops),
+      minimizer(_symbols, _ops)
+    {}
+
+std::vector<Clause> CNFBuilder::add(const std::string& expression)
+{
+    return add(AST(symbols, ops, expression));
+}
+
+std::vector<Clause> CNFBuilder::add(AST wff)
+{
+    simplifier.simplify(wff);
+    parity_encoder.encode(wff, true); // Every earlier definition is already in the database
+    minimizer.minimize(wff);
+    transformer.applyTransformations(wff);
+
+    // Nothing this call defined is kept unless all of its clauses make it into the database
+    const size_t num_variables = variable_names.size();
+    std::vector<Clause> candidates;
+    try
+    {
+        collectClauses(wff.getRoot(), candidates);
+    }
+    catch (...)
+    {
+        for (size_t v=num_variables; v<variable_names.size(); v++)
+        {
+            variable_ids.erase(variable_names[v]);
+        }
+        variable_names.resize(num_variables);
+        throw;
+    }
+    parity_encoder.commitDefinitions();
+
+    std::vector<Clause> added;
+    for (Clause& clause : candidates)
+    {
+        Clause sorted = clause;
+        std::sort(sorted.begin(), sorted.end());
+        if (known_clauses.insert(sorted).second)
+        {
+            clauses.push_back(clause);
+            added.push_back(std::move(clause));
+        }
+    }
+    return added;
+}
+
+void CNFBuilder::collectClauses(const AST_node* curr, std::vector<Clause>& out)
+{
+    if (curr->token.type == OPERATOR && ops.getProperties(curr->token.lexeme).kind == OP_AND)
+    {
+        for (const AST_node* child : curr->children)
+        {
+            collectClauses(child, out);
+        }
+        return;
+    }
+
+    Clause clause;
+    if (collectLiterals(curr, clause))
+    {
+        // Duplicate literals are dropped and tautologies (v and -v in the same clause) are always true, so skipped
+        std::sort(clause.begin(), clause.end(), [](int a, int b)
+        {
+            return std::abs(a) < std::abs(b) || (std::abs(a) == std::abs(b) && a < b);
+        });
+        clause.erase(std::unique(clause.begin(), clause.end()), clause.end());
+        for (size_t i=1; i<clause.size(); i++)
+        {
+            if (clause[i] == -clause[i-1])
+            {
+                return;
+            }
+        }
+        out.push_back(std::move(clause));
+    }
+}
+
+bool CNFBuilder::collectLiterals(const AST_node* curr, Clause& clause)
+{
+    // Returns false when the clause is trivially true
+    if (curr->token.type == VARIABLE)
+    {
+        clause.push_back(variableId(curr->token.lexeme));
+        return true;
+    }
+    if (curr->token.type == CONSTANT)
+    {
+        return symbols.getConstValue(curr->token.lexeme) != CONST_TRUE; // A false literal just drops out of the clause
+    }
+
+    OperatorKind kind = ops.getProperties(curr->token.lexeme).kind;
+    if (kind == OP_NOT && curr->children[0]->token.type == VARIABLE)
+    {
+        clause.push_back(-variableId(curr->children[0]->token.lexeme));
+        return true;
+    }
+    if (kind == OP_NOT && curr->children[0]->token.type == CONSTANT)
+    {
+        return symbols.getConstValue(curr->children[0]->token.lexeme) == CONST_TRUE;
+    }
+    if (kind == OP_OR)
+    {
+        return collectLiterals(curr->children[0], clause) && collectLiterals(curr->children[1], clause);
+    }
+
+    throw std::runtime_error("Operator '" + curr->token.lexeme + "' found inside a clause in CNFBuilder.add()");
+}
+
+int CNFBuilder::variableId(const std::string& name)
+{
+    auto it = variable_ids.find(name);
+    if (it != variable_ids.end())
+    {
+        return it->second;
+    }
+    variable_names.push_back(name);
+    variable_ids.insert({name, static_cast<int>(variable_names.size())});
+    return static_cast<int>(variable_names.size());
+}
+
+const std::vector<Clause>& CNFBuilder::getClauses() const
+{
+    return clauses;
+}
+
+const std::string& CNFBuilder::getVariableName(const int variable) const
+{
+    return variable_names.at(std::abs(variable) - 1);
+}
+
+int CNFBuilder::getNumVariables() const
+{
+    return static_cast<int>(variable_names.size());
+}
+
+void CNFBuilder::writeDimacs(std::ostream& os) const
+{
+    os << "p cnf " << variable_names.size() << " " << clauses.size() << "\n";
+    for (size_t v=0; v<variable_names.size(); v++)
+    {
+        os << "c " << v+1 << " " << variable_names[v] << "\n";
+    }
+    for (const Clause& clause : clauses)
+    {
+        for (int literal : clause)
+        {
+            os << literal << " ";
+        }
+        os << "0\n";
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef WFF2CNF_CNFBUILDER_HPP
+#define WFF2CNF_CNFBUILDER_HPP
+
+#include "AST.hpp"
+#include "Clause.hpp"
+#include "Minimizer.hpp"
+#include "Operators.hpp"
+#include "ParityEncoder.hpp"
+#include "Simplifier.hpp"
+#include "Symbols.hpp"
+#include "Transformer.hpp"
+#include <ostream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// CNFBuilder grows a clause database one WFF at a time. Every call to add() converts only the new WFF, conjoins it onto
+// the clauses that are already there, and returns just the clauses that were not in the database yet, so they can be
+// streamed to an incremental SAT solver.
+//
+// The variable map persists across calls, so a variable keeps its number for the lifetime of the builder. XOR/IFF aux
+// variables are shared the same way: a subformula that already has an aux variable from an earlier add() reuses it
+// instead of being defined again.
+class CNFBuilder
+{
+private:
+    const Symbols symbols;
+    const Operators ops;
+    Transformer transformer;
+    Simplifier simplifier;
+    ParityEncoder parity_encoder;
+    Minimizer minimizer;
+
+    std::vector<Clause> clauses;
+    std::set<Clause> known_clauses; // Sorted copies of every clause in the database, to skip duplicates
+    std::vector<std::string> variable_names; // variable_names[v-1] is the name of variable v
+    std::unordered_map<std::string,int> variable_ids;
+
+    int variableId(const std::string&);
+    void collectClauses(const AST_node*, std::vector<Clause>&);
+    bool collectLiterals(const AST_node*, Clause&);
+
+public:
+    CNFBuilder(const Symbols&, const Operators&, const Transformer&);
+
+    std::vector<Clause> add(const std::string&);
+    std::vector<Clause> add(AST);
+
+    const std::vector<Clause>& getClauses() const;
+    const std::string& getVariableName(int) const;
+    int getNumVariables() const;
+    void writeDimacs(std::ostream&) const;
+};
+
+#endif //WFF2CNF_CNFBUILDER_HPP
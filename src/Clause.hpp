@@ -0,0 +1,10 @@
+#ifndef WFF2CNF_CLAUSE_HPP
+#define WFF2CNF_CLAUSE_HPP
+
+#include <vector>
+
+// A clause is a disjunction of DIMACS-style literals: variable v is the integer v, and !v is -v (variables start at 1).
+// An empty clause is unsatisfiable.
+typedef std::vector<int> Clause;
+
+#endif //WFF2CNF_CLAUSE_HPP
@@ -0,0 +1,332 @@
+#include "CompactAST.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+const uint32_t CompactAST::ID_MASK;
+const size_t CompactAST::UNBOUND;
+
+CompactAST::CompactAST(const Symbols& _symbols, const Operators& _ops, const AST& wff)
+    : symbols(_symbols),
+      ops(_ops)
+{
+    std::vector<std::string> lexemes = ops.getLexemes();
+    std::sort(lexemes.begin(), lexemes.end());
+    for (const std::string& lexeme : lexemes)
+    {
+        const OperationProperties& properties = ops.getProperties(lexeme);
+        operator_ids[lexeme] = static_cast<uint32_t>(operators.size());
+        operators.push_back({lexeme, properties.kind, properties.arity == UNARY,
+                             properties.associativity == ASSOCIATIVE});
+    }
+
+    // Iterative post-order walk, so deep trees can't exhaust the call stack
+    struct Frame
+    {
+        const AST_node* node;
+        size_t next_child;
+        size_t start; // Index the node's subtree starts at
+    };
+    std::vector<Frame> stack = {{wff.getRoot(), 0, 0}};
+    while (!stack.empty())
+    {
+        Frame& top = stack.back();
+        if (top.next_child < top.node->children.size())
+        {
+            const AST_node* child = top.node->children[top.next_child++];
+            stack.push_back({child, 0, codes.size()});
+        }
+        else
+        {
+            codes.push_back(encodeToken(top.node->token));
+            sizes.push_back(static_cast<uint32_t>(codes.size() - top.start));
+            stack.pop_back();
+        }
+    }
+    codes.shrink_to_fit();
+    sizes.shrink_to_fit();
+}
+
+uint32_t CompactAST::encodeToken(const Token& token)
+{
+    if (token.type == VARIABLE)
+    {
+        auto inserted = variable_ids.insert({token.lexeme, static_cast<uint32_t>(variables.size())});
+        if (inserted.second)
+        {
+            if (variables.size() > ID_MASK)
+            {
+                throw std::runtime_error("Too many variables in CompactAST()");
+            }
+            variables.push_back(token.lexeme);
+        }
+        return encode(TAG_VARIABLE, inserted.first->second);
+    }
+    if (token.type == CONSTANT)
+    {
+        return encode(TAG_CONSTANT, symbols.getConstValue(token.lexeme));
+    }
+
+    auto it = operator_ids.find(token.lexeme);
+    if (token.type != OPERATOR || it == operator_ids.end())
+    {
+        throw std::runtime_error("Unexpected token '" + token.lexeme + "' in CompactAST()");
+    }
+    return encode(TAG_OPERATOR, it->second);
+}
+
+const std::string& CompactAST::lexemeOf(const uint32_t code) const
+{
+    switch (tagOf(code))
+    {
+        case TAG_VARIABLE: return variables[idOf(code)];
+        case TAG_CONSTANT: return symbols.getConstLexeme(static_cast<ConstantValue>(idOf(code)));
+        default:           return operators[idOf(code)].lexeme;
+    }
+}
+
+size_t CompactAST::size() const
+{
+    return codes.size();
+}
+
+size_t CompactAST::getRoot() const
+{
+    return codes.size() - 1;
+}
+
+size_t CompactAST::getFirstChild(const size_t node) const
+{
+    return operators[idOf(codes[node])].unary ? node - 1 : node - 1 - sizes[node - 1];
+}
+
+size_t CompactAST::getLastChild(const size_t node) const
+{
+    return node - 1;
+}
+
+const std::vector<std::string>& CompactAST::getVariables() const
+{
+    return variables;
+}
+
+size_t CompactAST::memoryBytes() const
+{
+    size_t bytes = (codes.capacity() + sizes.capacity()) * sizeof(uint32_t)
+                   + operators.capacity() * sizeof(OperatorEntry)
+                   + variables.capacity() * sizeof(std::string);
+    for (const std::string& name : variables)
+    {
+        bytes += name.capacity() + 1;
+    }
+    return bytes;
+}
+
+bool CompactAST::isEqual(const size_t a, const size_t b) const
+{
+    return sizes[a] == sizes[b]
+           && std::equal(codes.begin() + (a + 1 - sizes[a]), codes.begin() + (a + 1), codes.begin() + (b + 1 - sizes[b]));
+}
+
+bool CompactAST::isEqual(const CompactAST& other) const
+{
+    if (codes.size() != other.codes.size())
+    {
+        return false;
+    }
+
+    // Ids are local to each tree, so translate ours into the other's once instead of comparing names per node
+    std::vector<uint32_t> variable_map(variables.size(), ID_MASK);
+    for (size_t v=0; v<variables.size(); v++)
+    {
+        auto it = other.variable_ids.find(variables[v]);
+        if (it != other.variable_ids.end())
+        {
+            variable_map[v] = it->second;
+        }
+    }
+    std::vector<uint32_t> operator_map(operators.size(), ID_MASK);
+    for (size_t o=0; o<operators.size(); o++)
+    {
+        auto it = other.operator_ids.find(operators[o].lexeme);
+        if (it != other.operator_ids.end())
+        {
+            operator_map[o] = it->second;
+        }
+    }
+
+    for (size_t i=0; i<codes.size(); i++)
+    {
+        uint32_t code = codes[i];
+        switch (tagOf(code))
+        {
+            case TAG_VARIABLE: code = encode(TAG_VARIABLE, variable_map[idOf(code)]); break;
+            case TAG_OPERATOR: code = encode(TAG_OPERATOR, operator_map[idOf(code)]); break;
+            default: break;
+        }
+        if (code != other.codes[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CompactAST::needsParens(const uint32_t parent, const size_t child) const
+{
+    // Same rule as Serializer: binary operands need parentheses unless they chain the parent's associative operator
+    const uint32_t code = codes[child];
+    if (tagOf(code) != TAG_OPERATOR || operators[idOf(code)].unary)
+    {
+        return false;
+    }
+    return code != parent || !operators[idOf(code)].associative;
+}
+
+void CompactAST::writeNode(const size_t node, std::string& out) const
+{
+    const uint32_t code = codes[node];
+    if (tagOf(code) != TAG_OPERATOR)
+    {
+        out += lexemeOf(code);
+        return;
+    }
+
+    const OperatorEntry& entry = operators[idOf(code)];
+    if (entry.unary)
+    {
+        out += entry.lexeme;
+    }
+    const size_t children[2] = {getFirstChild(node), getLastChild(node)};
+    for (size_t i = entry.unary ? 1 : 0; i<2; i++)
+    {
+        bool parens = needsParens(code, children[i]);
+        if (parens)
+        {
+            out += '(';
+        }
+        writeNode(children[i], out);
+        if (parens)
+        {
+            out += ')';
+        }
+        if (i == 0)
+        {
+            out += entry.lexeme;
+        }
+    }
+}
+
+std::string CompactAST::toString() const
+{
+    std::string out;
+    out.reserve(codes.size() * 2);
+    writeNode(getRoot(), out);
+    return out;
+}
+
+bool CompactAST::matchNode(const size_t node,
+                           const CompactAST& pattern,
+                           const size_t pattern_node,
+                           std::vector<size_t>& bindings) const
+{
+    // Same semantics as Transformer's match: operators and constants must be identical, and a pattern variable binds
+    // to the first subtree it meets and must be equal to it everywhere else
+    const uint32_t pattern_code = pattern.codes[pattern_node];
+    const uint32_t code = codes[node];
+    switch (tagOf(pattern_code))
+    {
+        case TAG_VARIABLE:
+        {
+            size_t& bound = bindings[idOf(pattern_code)];
+            if (bound == UNBOUND)
+            {
+                bound = node;
+                return true;
+            }
+            return isEqual(bound, node);
+        }
+        case TAG_CONSTANT:
+            return code == pattern_code;
+        default:
+            break;
+    }
+
+    // Both trees number their operators the same way, so comparing the codes compares tag and operator at once
+    if (code != pattern_code)
+    {
+        return false;
+    }
+    if (operators[idOf(code)].unary)
+    {
+        return matchNode(node - 1, pattern, pattern_node - 1, bindings);
+    }
+    return matchNode(getFirstChild(node), pattern, pattern.getFirstChild(pattern_node), bindings)
+           && matchNode(node - 1, pattern, pattern_node - 1, bindings);
+}
+
+bool CompactAST::match(const size_t node, const CompactAST& pattern, std::vector<size_t>& bindings) const
+{
+    bindings.assign(pattern.variables.size(), UNBOUND);
+    return matchNode(node, pattern, pattern.getRoot(), bindings);
+}
+
+uint64_t CompactAST::evaluate(const std::vector<uint64_t>& values) const
+{
+    if (values.size() != variables.size())
+    {
+        throw std::runtime_error("Expected " + std::to_string(variables.size()) + " values but got "
+                                 + std::to_string(values.size()) + " in CompactAST.evaluate()");
+    }
+
+    std::vector<uint64_t> stack;
+    for (uint32_t code : codes)
+    {
+        if (tagOf(code) == TAG_VARIABLE)
+        {
+            stack.push_back(values[idOf(code)]);
+            continue;
+        }
+        if (tagOf(code) == TAG_CONSTANT)
+        {
+            stack.push_back(idOf(code) == CONST_TRUE ? ~0ULL : 0);
+            continue;
+        }
+
+        const OperatorKind kind = operators[idOf(code)].kind;
+        if (kind == OP_NOT)
+        {
+            stack.back() = ~stack.back();
+            continue;
+        }
+        uint64_t right = stack.back();
+        stack.pop_back();
+        uint64_t& left = stack.back();
+        switch (kind)
+        {
+            case OP_AND:     left &= right; break;
+            case OP_OR:      left |= right; break;
+            case OP_XOR:     left ^= right; break;
+            case OP_IFF:     left = ~(left ^ right); break;
+            case OP_IMPLIES: left = ~left | right; break;
+            default: break;
+        }
+    }
+    return stack.back();
+}
+
+AST CompactAST::toAST() const
+{
+    std::vector<AST_node*> stack;
+    for (uint32_t code : codes)
+    {
+        const Tag tag = tagOf(code);
+        AST_node* node = new AST_node(Token(tag == TAG_VARIABLE ? VARIABLE : tag == TAG_CONSTANT ? CONSTANT : OPERATOR,
+                                            lexemeOf(code)));
+        size_t arity = tag != TAG_OPERATOR ? 0 : operators[idOf(code)].unary ? 1 : 2;
+        node->children.assign(stack.end() - arity, stack.end());
+        stack.resize(stack.size() - arity);
+        stack.push_back(node);
+    }
+    return AST(symbols, ops, stack.back());
+}
@@ -0,0 +1,89 @@
+#ifndef WFF2CNF_COMPACTAST_HPP
+#define WFF2CNF_COMPACTAST_HPP
+
+#include "AST.hpp"
+#include "Operators.hpp"
+#include "Symbols.hpp"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// CompactAST stores a WFF as two parallel arrays of 32-bit words in post-order, 8 bytes per node and no per-node
+// allocations, instead of an AST_node (a Token with its std::string plus a std::vector of children, 64 bytes and up to
+// two heap blocks per node).
+//
+// codes[i] packs a 2-bit tag (variable, constant or operator) with a 30-bit id: an index into the variable table, a
+// ConstantValue, or an index into the operator table. sizes[i] is the number of nodes in the subtree rooted at i, so
+// that subtree occupies exactly [i - sizes[i] + 1, i]. The last child of node i is always i-1 and a binary node's
+// first child is i-1-sizes[i-1].
+//
+// Since the arity of every code is known, a post-order sequence of codes determines the tree, so two subtrees are
+// equal exactly when their code ranges are, and equality, evaluation and conversion are linear scans. Printing and
+// matching recurse like their AST_node counterparts, but every subtree they visit is one contiguous range.
+//
+// No pipeline stage uses it yet; benchmarks/layout_benchmark.cpp compares it with the AST_node layout.
+class CompactAST
+{
+private:
+    enum Tag : uint32_t
+    {
+        TAG_VARIABLE,
+        TAG_CONSTANT,
+        TAG_OPERATOR
+    };
+
+    struct OperatorEntry
+    {
+        std::string lexeme;
+        OperatorKind kind;
+        bool unary;
+        bool associative;
+    };
+
+    static const uint32_t TAG_SHIFT = 30;
+    static const uint32_t ID_MASK = (1u << TAG_SHIFT) - 1;
+
+    Symbols symbols;
+    Operators ops;
+    std::vector<uint32_t> codes;
+    std::vector<uint32_t> sizes;
+    std::vector<OperatorEntry> operators; // Sorted by lexeme, so trees built with the same Operators share ids
+    std::unordered_map<std::string,uint32_t> operator_ids;
+    std::vector<std::string> variables;
+    std::unordered_map<std::string,uint32_t> variable_ids;
+
+    static uint32_t encode(Tag tag, uint32_t id) { return (static_cast<uint32_t>(tag) << TAG_SHIFT) | id; }
+    static Tag tagOf(uint32_t code) { return static_cast<Tag>(code >> TAG_SHIFT); }
+    static uint32_t idOf(uint32_t code) { return code & ID_MASK; }
+
+    uint32_t encodeToken(const Token&);
+    const std::string& lexemeOf(uint32_t) const;
+    bool needsParens(uint32_t, size_t) const;
+    void writeNode(size_t, std::string&) const;
+    bool matchNode(size_t, const CompactAST&, size_t, std::vector<size_t>&) const;
+
+public:
+    static const size_t UNBOUND = SIZE_MAX;
+
+    CompactAST(const Symbols&, const Operators&, const AST&);
+
+    size_t size() const;
+    size_t getRoot() const;
+    size_t getFirstChild(size_t) const;
+    size_t getLastChild(size_t) const;
+    const std::vector<std::string>& getVariables() const;
+    size_t memoryBytes() const;
+
+    bool isEqual(size_t, size_t) const; // Subtrees of this tree
+    bool isEqual(const CompactAST&) const;
+    std::string toString() const;
+    // bindings is indexed by the pattern's variable ids and holds the node each pattern variable matched, or UNBOUND.
+    // The pattern has to be built with the same Operators, so that operator ids can be compared directly.
+    bool match(size_t, const CompactAST& pattern, std::vector<size_t>& bindings) const;
+    // values[v] holds 64 assignments of the v-th variable in getVariables(), and so does the result
+    uint64_t evaluate(const std::vector<uint64_t>& values) const;
+    AST toAST() const;
+};
+
+#endif //WFF2CNF_COMPACTAST_HPP
@@ -0,0 +1,144 @@
+#include "MemoryStats.hpp"
+#include "AST.hpp"
+
+size_t MemoryStats::live_nodes = 0;
+size_t MemoryStats::peak_nodes = 0;
+size_t MemoryStats::nodes_created = 0;
+size_t MemoryStats::nodes_freed = 0;
+CategoryStats MemoryStats::categories[ALLOC_CATEGORY_COUNT];
+std::map<std::string,RuleStats> MemoryStats::rules;
+
+void MemoryStats::nodeCreated()
+{
+    live_nodes++;
+    nodes_created++;
+    if (live_nodes > peak_nodes)
+    {
+        peak_nodes = live_nodes;
+    }
+    allocated(ALLOC_AST_NODES, sizeof(AST_node));
+}
+
+void MemoryStats::nodeFreed()
+{
+    live_nodes--;
+    nodes_freed++;
+    released(ALLOC_AST_NODES, sizeof(AST_node));
+}
+
+void MemoryStats::allocated(AllocCategory category, size_t bytes)
+{
+    CategoryStats& stats = categories[category];
+    stats.current_bytes += bytes;
+    stats.total_bytes += bytes;
+    if (stats.current_bytes > stats.peak_bytes)
+    {
+        stats.peak_bytes = stats.current_bytes;
+    }
+}
+
+void MemoryStats::released(AllocCategory category, size_t bytes)
+{
+    categories[category].current_bytes -= bytes;
+}
+
+void MemoryStats::ruleApplied(const std::string& rule, size_t created, size_t freed)
+{
+    RuleStats& stats = rules[rule];
+    stats.applications++;
+    stats.nodes_created += created;
+    stats.nodes_freed += freed;
+}
+
+size_t MemoryStats::getLiveNodes()
+{
+    return live_nodes;
+}
+
+size_t MemoryStats::getPeakNodes()
+{
+    return peak_nodes;
+}
+
+size_t MemoryStats::getNodesCreated()
+{
+    return nodes_created;
+}
+
+size_t MemoryStats::getNodesFreed()
+{
+    return nodes_freed;
+}
+
+const CategoryStats& MemoryStats::getCategory(AllocCategory category)
+{
+    return categories[category];
+}
+
+const std::map<std::string,RuleStats>& MemoryStats::getRules()
+{
+    return rules;
+}
+
+void MemoryStats::reset()
+{
+    // Live counts describe memory that still exists, so only the history is cleared
+    peak_nodes = live_nodes;
+    nodes_created = 0;
+    nodes_freed = 0;
+    for (CategoryStats& stats : categories)
+    {
+        stats.peak_bytes = stats.current_bytes;
+        stats.total_bytes = 0;
+    }
+    rules.clear();
+}
+
+static void writeJsonString(std::ostream& os, const std::string& str)
+{
+    os << '"';
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            os << '\\';
+        }
+        os << c;
+    }
+    os << '"';
+}
+
+void MemoryStats::writeJson(std::ostream& os)
+{
+    static const char* category_names[ALLOC_CATEGORY_COUNT] = {"ast_nodes", "bindings", "tokens"};
+
+    os << "{\n";
+    os << "  \"live_nodes\": " << live_nodes << ",\n";
+    os << "  \"peak_nodes\": " << peak_nodes << ",\n";
+    os << "  \"nodes_created\": " << nodes_created << ",\n";
+    os << "  \"nodes_freed\": " << nodes_freed << ",\n";
+
+    os << "  \"bytes\": {";
+    for (int i=0; i<ALLOC_CATEGORY_COUNT; i++)
+    {
+        os << (i ? ",\n" : "\n") << "    \"" << category_names[i] << "\": {"
+           << "\"current\": " << categories[i].current_bytes << ", "
+           << "\"peak\": " << categories[i].peak_bytes << ", "
+           << "\"total\": " << categories[i].total_bytes << "}";
+    }
+    os << "\n  },\n";
+
+    os << "  \"rules\": {";
+    bool first = true;
+    for (const auto& pair : rules)
+    {
+        os << (first ? "\n" : ",\n") << "    ";
+        writeJsonString(os, pair.first);
+        os << ": {\"applications\": " << pair.second.applications << ", "
+           << "\"nodes_created\": " << pair.second.nodes_created << ", "
+           << "\"nodes_freed\": " << pair.second.nodes_freed << "}";
+        first = false;
+    }
+    os << (first ? "}\n" : "\n  }\n");
+    os << "}\n";
+}
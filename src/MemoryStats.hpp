@@ -0,0 +1,64 @@
+#ifndef WFF2CNF_MEMORYSTATS_HPP
+#define WFF2CNF_MEMORYSTATS_HPP
+
+#include <cstddef>
+#include <map>
+#include <ostream>
+#include <string>
+
+enum AllocCategory
+{
+    ALLOC_AST_NODES,
+    ALLOC_BINDINGS,
+    ALLOC_TOKENS,
+    ALLOC_CATEGORY_COUNT
+};
+
+struct CategoryStats
+{
+    size_t current_bytes = 0;
+    size_t peak_bytes = 0;
+    size_t total_bytes = 0; // Cumulative bytes ever allocated in this category
+};
+
+struct RuleStats
+{
+    size_t applications = 0;
+    size_t nodes_created = 0;
+    size_t nodes_freed = 0;
+};
+
+// MemoryStats is a process-wide accounting of the allocations made by the AST and the rewrite engine. AST_node
+// reports its own construction and destruction, so live/peak node counts are always exact; the other categories are
+// reported by the code that owns those buffers.
+//
+// The counters are not synchronized, so they are only meaningful when the AST is built and transformed on one thread.
+class MemoryStats
+{
+private:
+    static size_t live_nodes;
+    static size_t peak_nodes;
+    static size_t nodes_created;
+    static size_t nodes_freed;
+    static CategoryStats categories[ALLOC_CATEGORY_COUNT];
+    static std::map<std::string,RuleStats> rules;
+
+public:
+    static void nodeCreated();
+    static void nodeFreed();
+    static void allocated(AllocCategory, size_t);
+    static void released(AllocCategory, size_t);
+    static void ruleApplied(const std::string&, size_t, size_t);
+
+    static size_t getLiveNodes();
+    static size_t getPeakNodes();
+    static size_t getNodesCreated();
+    static size_t getNodesFreed();
+    static const CategoryStats& getCategory(AllocCategory);
+    static const std::map<std::string,RuleStats>& getRules();
+
+    static void reset();
+    static void writeJson(std::ostream&);
+};
+
+#endif //WFF2CNF_MEMORYSTATS_HPP
@@ -0,0 +1,523 @@
+#include "Minimizer.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_set>
+
+// Bit m of a table is the function's value for assignment m, where variable i has value (m >> i) & 1. These are the
+// columns of the first six variables within a single word.
+static const uint64_t LOW_COLUMNS[6] = {
+    0xAAAAAAAAAAAAAAAAULL,
+    0xCCCCCCCCCCCCCCCCULL,
+    0xF0F0F0F0F0F0F0F0ULL,
+    0xFF00FF00FF00FF00ULL,
+    0xFFFF0000FFFF0000ULL,
+    0xFFFFFFFF00000000ULL
+};
+
+static size_t tableWords(const int support)
+{
+    return support <= 6 ? 1 : size_t(1) << (support - 6);
+}
+
+static uint64_t firstWordMask(const int support)
+{
+    return support >= 6 ? ~0ULL : (1ULL << (1 << support)) - 1;
+}
+
+Minimizer::Minimizer(const Symbols& _symbols, const Operators& _ops, const int _max_support)
+    : symbols(_symbols),
+      ops(_ops),
+      max_support(_max_support)
+{
+    if (max_support < 1 || max_support > MAX_SUPPORT_LIMIT)
+    {
+        throw std::runtime_error("Max support must be between 1 and " + std::to_string(MAX_SUPPORT_LIMIT)
+                                 + " in Minimizer()");
+    }
+}
+
+void Minimizer::minimize(AST& wff)
+{
+    std::vector<std::string> support;
+    AST_node* root = wff.getMutableRoot();
+    if (minimizeNode(root, support))
+    {
+        replaceSubtree(root, support);
+    }
+}
+
+bool Minimizer::minimizeNode(AST_node* curr, std::vector<std::string>& support)
+{
+    // Returns whether curr's support is small enough, in which case the caller decides whether to replace it (a
+    // bigger cone containing it may be replaced instead). Otherwise the children that are small enough are maximal
+    // cones, so they are replaced right here.
+    if (curr->token.type == VARIABLE)
+    {
+        support.assign(1, curr->token.lexeme);
+        return true;
+    }
+    if (curr->token.type == CONSTANT)
+    {
+        support.clear();
+        return true;
+    }
+
+    std::vector<std::vector<std::string>> child_supports(curr->children.size());
+    std::vector<bool> child_fits(curr->children.size());
+    bool all_fit = true;
+    for (size_t i=0; i<curr->children.size(); i++)
+    {
+        child_fits[i] = minimizeNode(curr->children[i], child_supports[i]);
+        all_fit = all_fit && child_fits[i];
+    }
+
+    if (all_fit)
+    {
+        support.clear();
+        for (const std::vector<std::string>& child_support : child_supports)
+        {
+            std::vector<std::string> merged;
+            std::set_union(support.begin(), support.end(), child_support.begin(), child_support.end(),
+                           std::back_inserter(merged));
+            support.swap(merged);
+        }
+        if (support.size() <= static_cast<size_t>(max_support))
+        {
+            return true;
+        }
+    }
+
+    for (size_t i=0; i<curr->children.size(); i++)
+    {
+        if (child_fits[i])
+        {
+            replaceSubtree(curr->children[i], child_supports[i]);
+        }
+    }
+    return false;
+}
+
+void Minimizer::replaceSubtree(AST_node* curr, const std::vector<std::string>& support)
+{
+    if (curr->children.empty() || (curr->children.size() == 1 && curr->children[0]->children.empty()))
+    {
+        return; // Literals (and !1, !0 which the Simplifier handles) can't get any smaller
+    }
+
+    const int k = static_cast<int>(support.size());
+    const size_t words = tableWords(k);
+    TruthTable on = evaluate(curr, support, words);
+
+    std::string key(1, static_cast<char>(k));
+    key.append(reinterpret_cast<const char*>(on.data()), on.size() * sizeof(uint64_t));
+    auto cached = cache.find(key);
+    if (cached == cache.end())
+    {
+        TruthTable off(words);
+        for (size_t w=0; w<words; w++)
+        {
+            off[w] = ~on[w];
+        }
+        off[0] &= firstWordMask(k);
+        std::vector<Cube> cover = k <= EXACT_SUPPORT ? coverExact(on, k) : coverHeuristic(on, off, k);
+        cached = cache.insert({key, cover}).first;
+    }
+
+    AST_node* cnf = buildCnf(cached->second, support);
+    if (isCnf(curr, 0) && countNodes(cnf) >= countNodes(curr))
+    {
+        AST::deleteTree(cnf); // Already a CNF and at least as small
+        return;
+    }
+
+    for (AST_node* child : curr->children)
+    {
+        AST::deleteTree(child);
+    }
+    curr->token = cnf->token;
+    curr->children.swap(cnf->children);
+    cnf->children.clear();
+    delete cnf;
+}
+
+Minimizer::TruthTable Minimizer::evaluate(const AST_node* curr,
+                                          const std::vector<std::string>& support,
+                                          const size_t words) const
+{
+    const int k = static_cast<int>(support.size());
+    if (curr->token.type == VARIABLE)
+    {
+        auto it = std::lower_bound(support.begin(), support.end(), curr->token.lexeme);
+        return column(static_cast<int>(it - support.begin()), words, k);
+    }
+    if (curr->token.type == CONSTANT)
+    {
+        TruthTable result(words, symbols.getConstValue(curr->token.lexeme) == CONST_TRUE ? ~0ULL : 0);
+        result[0] &= firstWordMask(k);
+        return result;
+    }
+
+    const OperatorKind kind = ops.getProperties(curr->token.lexeme).kind;
+    TruthTable result = evaluate(curr->children[0], support, words);
+    if (kind == OP_NOT)
+    {
+        for (uint64_t& word : result)
+        {
+            word = ~word;
+        }
+        result[0] &= firstWordMask(k);
+        return result;
+    }
+
+    const TruthTable right = evaluate(curr->children[1], support, words);
+    for (size_t w=0; w<words; w++)
+    {
+        switch (kind)
+        {
+            case OP_AND:     result[w] &= right[w]; break;
+            case OP_OR:      result[w] |= right[w]; break;
+            case OP_XOR:     result[w] ^= right[w]; break;
+            case OP_IFF:     result[w] = ~(result[w] ^ right[w]); break;
+            case OP_IMPLIES: result[w] = ~result[w] | right[w]; break;
+            default: break;
+        }
+    }
+    result[0] &= firstWordMask(k);
+    return result;
+}
+
+Minimizer::TruthTable Minimizer::column(const int variable, const size_t words, const int support)
+{
+    TruthTable result(words);
+    for (size_t w=0; w<words; w++)
+    {
+        if (variable < 6)
+        {
+            result[w] = LOW_COLUMNS[variable];
+        }
+        else
+        {
+            result[w] = ((w >> (variable - 6)) & 1) ? ~0ULL : 0;
+        }
+    }
+    result[0] &= firstWordMask(support);
+    return result;
+}
+
+Minimizer::TruthTable Minimizer::cubeMask(const Cube& cube, const size_t words, const int support)
+{
+    TruthTable result(words, ~0ULL);
+    result[0] &= firstWordMask(support);
+    for (int i=0; i<support; i++)
+    {
+        if (!((cube.care >> i) & 1))
+        {
+            continue;
+        }
+        TruthTable var = column(i, words, support);
+        bool positive = (cube.value >> i) & 1;
+        for (size_t w=0; w<words; w++)
+        {
+            result[w] &= positive ? var[w] : ~var[w];
+        }
+    }
+    return result;
+}
+
+bool Minimizer::intersects(const TruthTable& a, const TruthTable& b)
+{
+    for (size_t w=0; w<a.size(); w++)
+    {
+        if (a[w] & b[w])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<Minimizer::Cube> Minimizer::coverExact(const TruthTable& on, const int k) const
+{
+    const uint32_t all = (1u << k) - 1;
+    auto pack = [](const Cube& cube) { return (uint64_t(cube.care) << 32) | cube.value; };
+
+    std::vector<uint32_t> zeros;
+    std::vector<Cube> level;
+    for (uint32_t m=0; m < (1u << k); m++)
+    {
+        if (!((on[m / 64] >> (m % 64)) & 1))
+        {
+            zeros.push_back(m);
+            level.push_back({all, m});
+        }
+    }
+
+    // Quine-McCluskey: merge cubes that differ in one cared variable until nothing merges; the leftovers are primes
+    std::vector<Cube> primes;
+    while (!level.empty())
+    {
+        std::unordered_set<uint64_t> present;
+        for (const Cube& cube : level)
+        {
+            present.insert(pack(cube));
+        }
+
+        std::unordered_set<uint64_t> merged;
+        std::unordered_set<uint64_t> next_keys;
+        std::vector<Cube> next;
+        for (const Cube& cube : level)
+        {
+            for (int i=0; i<k; i++)
+            {
+                uint32_t bit = 1u << i;
+                if (!(cube.care & bit) || (cube.value & bit))
+                {
+                    continue;
+                }
+                Cube partner = {cube.care, cube.value | bit};
+                if (present.count(pack(partner)))
+                {
+                    merged.insert(pack(cube));
+                    merged.insert(pack(partner));
+                    Cube combined = {cube.care & ~bit, cube.value};
+                    if (next_keys.insert(pack(combined)).second)
+                    {
+                        next.push_back(combined);
+                    }
+                }
+            }
+        }
+        for (const Cube& cube : level)
+        {
+            if (!merged.count(pack(cube)))
+            {
+                primes.push_back(cube);
+            }
+        }
+        level.swap(next);
+    }
+
+    // Cover the zeros: essential primes first, then repeatedly the prime that covers the most remaining zeros
+    std::vector<std::vector<size_t>> covering(zeros.size()); // Primes covering each zero
+    for (size_t p=0; p<primes.size(); p++)
+    {
+        for (size_t z=0; z<zeros.size(); z++)
+        {
+            if ((zeros[z] & primes[p].care) == primes[p].value)
+            {
+                covering[z].push_back(p);
+            }
+        }
+    }
+
+    std::vector<bool> covered(zeros.size(), false);
+    std::vector<bool> chosen(primes.size(), false);
+    std::vector<Cube> cover;
+    auto choose = [&](size_t p)
+    {
+        chosen[p] = true;
+        cover.push_back(primes[p]);
+        for (size_t z=0; z<zeros.size(); z++)
+        {
+            if ((zeros[z] & primes[p].care) == primes[p].value)
+            {
+                covered[z] = true;
+            }
+        }
+    };
+
+    for (size_t z=0; z<zeros.size(); z++)
+    {
+        if (covering[z].size() == 1 && !chosen[covering[z][0]])
+        {
+            choose(covering[z][0]);
+        }
+    }
+    while (std::find(covered.begin(), covered.end(), false) != covered.end())
+    {
+        size_t best = 0;
+        size_t best_gain = 0;
+        for (size_t p=0; p<primes.size(); p++)
+        {
+            size_t gain = 0;
+            for (size_t z=0; z<zeros.size(); z++)
+            {
+                gain += !covered[z] && (zeros[z] & primes[p].care) == primes[p].value;
+            }
+            if (gain > best_gain)
+            {
+                best = p;
+                best_gain = gain;
+            }
+        }
+        choose(best);
+    }
+
+    // A prime picked greedily can end up covering only zeros that later picks cover as well
+    std::vector<TruthTable> masks;
+    for (const Cube& cube : cover)
+    {
+        masks.push_back(cubeMask(cube, on.size(), k));
+    }
+    return dropRedundant(cover, masks);
+}
+
+std::vector<Minimizer::Cube> Minimizer::coverHeuristic(const TruthTable& on, const TruthTable& off, const int k) const
+{
+    const size_t words = on.size();
+    std::vector<Cube> cover;
+    std::vector<TruthTable> masks;
+    TruthTable covered(words, 0);
+
+    for (uint32_t m=0; m < (1u << k); m++)
+    {
+        if (!((off[m / 64] >> (m % 64)) & 1) || ((covered[m / 64] >> (m % 64)) & 1))
+        {
+            continue;
+        }
+
+        // Expand the uncovered zero into a prime by dropping every variable the cube can do without
+        Cube cube = {(1u << k) - 1, m};
+        for (int i=0; i<k; i++)
+        {
+            Cube candidate = {cube.care & ~(1u << i), cube.value & ~(1u << i)};
+            if (!intersects(cubeMask(candidate, words, k), on))
+            {
+                cube = candidate;
+            }
+        }
+
+        TruthTable mask = cubeMask(cube, words, k);
+        for (size_t w=0; w<words; w++)
+        {
+            covered[w] |= mask[w];
+        }
+        cover.push_back(cube);
+        masks.push_back(mask);
+    }
+
+    return dropRedundant(cover, masks);
+}
+
+std::vector<Minimizer::Cube> Minimizer::dropRedundant(const std::vector<Cube>& cover,
+                                                      const std::vector<TruthTable>& masks)
+{
+    // Drop cubes whose zeros are all covered by the cubes that remain
+    const size_t words = masks.empty() ? 0 : masks[0].size();
+    std::vector<bool> kept(cover.size(), true);
+    for (size_t i=cover.size(); i-- > 0;)
+    {
+        TruthTable others(words, 0);
+        for (size_t j=0; j<cover.size(); j++)
+        {
+            if (j != i && kept[j])
+            {
+                for (size_t w=0; w<words; w++)
+                {
+                    others[w] |= masks[j][w];
+                }
+            }
+        }
+        bool redundant = true;
+        for (size_t w=0; w<words && redundant; w++)
+        {
+            redundant = (masks[i][w] & ~others[w]) == 0;
+        }
+        kept[i] = !redundant;
+    }
+
+    std::vector<Cube> result;
+    for (size_t i=0; i<cover.size(); i++)
+    {
+        if (kept[i])
+        {
+            result.push_back(cover[i]);
+        }
+    }
+    return result;
+}
+
+AST_node* Minimizer::buildCnf(const std::vector<Cube>& cover, const std::vector<std::string>& support) const
+{
+    // Each cube is a set of assignments where the function is false, so its clause is the negated cube
+    if (cover.empty())
+    {
+        return new AST_node(Token(CONSTANT, symbols.getConstLexeme(CONST_TRUE)));
+    }
+
+    AST_node* cnf = nullptr;
+    for (const Cube& cube : cover)
+    {
+        if (cube.care == 0)
+        {
+            AST::deleteTree(cnf);
+            return new AST_node(Token(CONSTANT, symbols.getConstLexeme(CONST_FALSE)));
+        }
+
+        AST_node* clause = nullptr;
+        for (size_t i=0; i<support.size(); i++)
+        {
+            if (!((cube.care >> i) & 1))
+            {
+                continue;
+            }
+            AST_node* literal = new AST_node(Token(VARIABLE, support[i]));
+            if ((cube.value >> i) & 1)
+            {
+                AST_node* negation = new AST_node(Token(OPERATOR, ops.getLexeme(OP_NOT)));
+                negation->children.push_back(literal);
+                literal = negation;
+            }
+            if (clause)
+            {
+                AST_node* disjunction = new AST_node(Token(OPERATOR, ops.getLexeme(OP_OR)));
+                disjunction->children.push_back(clause);
+                disjunction->children.push_back(literal);
+                literal = disjunction;
+            }
+            clause = literal;
+        }
+
+        if (cnf)
+        {
+            AST_node* conjunction = new AST_node(Token(OPERATOR, ops.getLexeme(OP_AND)));
+            conjunction->children.push_back(cnf);
+            conjunction->children.push_back(clause);
+            clause = conjunction;
+        }
+        cnf = clause;
+    }
+    return cnf;
+}
+
+bool Minimizer::isCnf(const AST_node* curr, const int level) const
+{
+    // level 0 may still be a conjunction, level 1 a disjunction, below that only literals are allowed
+    if (curr->token.type != OPERATOR)
+    {
+        return true;
+    }
+    const OperatorKind kind = ops.getProperties(curr->token.lexeme).kind;
+    if (kind == OP_NOT)
+    {
+        return curr->children[0]->token.type != OPERATOR;
+    }
+    if ((kind == OP_AND && level == 0) || (kind == OP_OR && level <= 1))
+    {
+        const int child_level = kind == OP_AND ? 0 : 1;
+        return isCnf(curr->children[0], child_level) && isCnf(curr->children[1], child_level);
+    }
+    return false;
+}
+
+size_t Minimizer::countNodes(const AST_node* curr)
+{
+    size_t count = 1;
+    for (const AST_node* child : curr->children)
+    {
+        count += countNodes(child);
+    }
+    return count;
+}
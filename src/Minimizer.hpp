@@ -0,0 +1,63 @@
+#ifndef WFF2CNF_MINIMIZER_HPP
+#define WFF2CNF_MINIMIZER_HPP
+
+#include "AST.hpp"
+#include "Operators.hpp"
+#include "Symbols.hpp"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Minimizer replaces every maximal subtree that depends on at most max_support variables with a small CNF of the
+// same function, so that small cones never go through distribution and the redundancy rules at all.
+//
+// The truth table of a cone is computed bit-parallel, 64 assignments per word. Its zeros are then covered with a small,
+// irredundant set of prime cubes, and each cube becomes one clause. Neither way of choosing the cover guarantees the
+// fewest clauses:
+//   - up to EXACT_SUPPORT variables the prime implicants are generated with Quine-McCluskey, essential primes are
+//     taken first and the rest of the cover is chosen greedily
+//   - above that, every uncovered zero is expanded into a prime one literal at a time (as in Espresso's EXPAND)
+// Either way, cubes whose zeros the other cubes already cover are dropped afterwards.
+//
+// Covers are cached by truth table over the cone's variables in sorted order, so repeated cones (even over different
+// variable names) cost a single lookup.
+class Minimizer
+{
+private:
+    struct Cube
+    {
+        uint32_t care;  // Bit i set: variable i is part of the cube
+        uint32_t value; // Value of variable i, for the variables in care
+    };
+
+    typedef std::vector<uint64_t> TruthTable;
+
+    static const int EXACT_SUPPORT = 8;
+    static const int MAX_SUPPORT_LIMIT = 16; // Tables grow as 2^support, so this is a hard cap
+
+    const Symbols symbols;
+    const Operators ops;
+    const int max_support;
+    std::unordered_map<std::string,std::vector<Cube>> cache;
+
+    bool minimizeNode(AST_node*, std::vector<std::string>&);
+    void replaceSubtree(AST_node*, const std::vector<std::string>&);
+    TruthTable evaluate(const AST_node*, const std::vector<std::string>&, size_t) const;
+    static TruthTable column(int, size_t, int);
+    static TruthTable cubeMask(const Cube&, size_t, int);
+    static bool intersects(const TruthTable&, const TruthTable&);
+    std::vector<Cube> coverExact(const TruthTable&, int) const;
+    std::vector<Cube> coverHeuristic(const TruthTable&, const TruthTable&, int) const;
+    static std::vector<Cube> dropRedundant(const std::vector<Cube>&, const std::vector<TruthTable>&);
+    AST_node* buildCnf(const std::vector<Cube>&, const std::vector<std::string>&) const;
+    bool isCnf(const AST_node*, int) const;
+    static size_t countNodes(const AST_node*);
+
+public:
+    Minimizer(const Symbols&, const Operators&, int max_support = 12);
+
+    void minimize(AST&);
+};
+
+#endif //WFF2CNF_MINIMIZER_HPP
@@ -4,6 +4,9 @@
 
 #include "Operators.hpp"
 
+#include <algorithm>
+#include <stdexcept>
+
 Operators::Operators(std::initializer_list<std::pair<std::string,OperationProperties>> ops)
     : operators([&ops]()
     {
@@ -60,6 +63,28 @@ bool Operators::hasHigherOrEqualPrecedence(const std::string& op1, const std::st
     return operators.at(op1).precedence >= operators.at(op2).precedence;
 }
 
+const std::string& Operators::getLexeme(OperatorKind kind) const
+{
+    for (const auto& pair : operators)
+    {
+        if (pair.second.kind == kind)
+        {
+            return pair.first;
+        }
+    }
+    throw std::runtime_error("No operator registered for kind " + std::to_string(kind) + " in Operators.getLexeme()");
+}
+
+std::vector<std::string> Operators::getLexemes() const
+{
+    std::vector<std::string> lexemes;
+    for (const auto& pair : operators)
+    {
+        lexemes.push_back(pair.first);
+    }
+    return lexemes;
+}
+
 bool Operators::partialMatch(const std::string& query) const
 {
     for (const auto& pair : operators)
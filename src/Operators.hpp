@@ -9,6 +9,7 @@
 #include <array>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 enum Associativity
 {
@@ -22,11 +23,22 @@ enum Arity
     BINARY
 };
 
+enum OperatorKind
+{
+    OP_NOT,
+    OP_AND,
+    OP_OR,
+    OP_IMPLIES,
+    OP_XOR,
+    OP_IFF
+};
+
 struct OperationProperties
 {
     int precedence;
     Associativity associativity;
     Arity arity;
+    OperatorKind kind; // Logical meaning of the operator, for passes that build or evaluate formulas directly
 };
 
 enum MatchLevel
@@ -49,6 +61,8 @@ public:
     const OperationProperties& getProperties(const std::string&) const;
     int getNumOperands(const std::string&) const;
     bool hasHigherOrEqualPrecedence(const std::string&, const std::string&) const;
+    const std::string& getLexeme(OperatorKind) const;
+    std::vector<std::string> getLexemes() const;
 };
 
 #endif //WFF2CNF_OPERATORS_HPP
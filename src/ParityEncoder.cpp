@@ -0,0 +1,357 @@
+#include "ParityEncoder.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+ParityEncoder::ParityEncoder(const Symbols& _symbols, const Operators& _ops, const size_t _chunk_size)
+    : symbols(_symbols),
+      ops(_ops),
+      chunk_size(_chunk_size)
+{
+    if (chunk_size < 2)
+    {
+        throw std::runtime_error("Chunk size must be at least 2 in ParityEncoder()");
+    }
+}
+
+void ParityEncoder::encode(AST& wff, const bool reuse_definitions)
+{
+    if (!reuse_definitions)
+    {
+        aux_variables.clear();
+    }
+    pending_aux_variables.clear();
+
+    AST_node*& root = wff.getMutableRoot();
+    encodeNode(root, false);
+
+    // Definitions are only ever collected while encoding, so conjoin them all onto the (already encoded) root
+    for (AST_node* definition : definitions)
+    {
+        root = makeBinary(OP_AND, root, definition);
+    }
+    definitions.clear();
+}
+
+void ParityEncoder::commitDefinitions()
+{
+    aux_variables.insert(pending_aux_variables.begin(), pending_aux_variables.end());
+    pending_aux_variables.clear();
+}
+
+bool ParityEncoder::isChain(const AST_node* curr) const
+{
+    // A ! directly above a chain is part of it, since it only flips the parity
+    if (curr->token.type != OPERATOR)
+    {
+        return false;
+    }
+    OperatorKind kind = ops.getProperties(curr->token.lexeme).kind;
+    return kind == OP_XOR || kind == OP_IFF || (kind == OP_NOT && isChain(curr->children[0]));
+}
+
+bool ParityEncoder::isLiteral(const AST_node* curr) const
+{
+    if (curr->token.type == VARIABLE)
+    {
+        return true;
+    }
+    return curr->token.type == OPERATOR
+           && ops.getProperties(curr->token.lexeme).kind == OP_NOT
+           && curr->children[0]->token.type == VARIABLE;
+}
+
+void ParityEncoder::encodeNode(AST_node*& curr, const bool negative)
+{
+    // negative is whether curr sits under an odd number of negations, counting the left side of =>
+    if (isChain(curr))
+    {
+        if (negative)
+        {
+            curr = literalFor(curr);
+            return;
+        }
+
+        bool parity = false;
+        std::vector<AST_node*> literals = chainLiterals(curr, parity);
+        curr = expandParity(literals, parity);
+        for (AST_node* literal : literals)
+        {
+            AST::deleteTree(literal);
+        }
+        return;
+    }
+
+    if (curr->token.type != OPERATOR)
+    {
+        return;
+    }
+    OperatorKind kind = ops.getProperties(curr->token.lexeme).kind;
+    for (size_t i=0; i<curr->children.size(); i++)
+    {
+        bool flips = kind == OP_NOT || (kind == OP_IMPLIES && i == 0);
+        encodeNode(curr->children[i], negative != flips);
+    }
+}
+
+std::vector<AST_node*> ParityEncoder::chainLiterals(AST_node* chain, bool& parity)
+{
+    // Takes ownership of the chain and returns at most chunk_size literals whose XOR, flipped if parity is set, is
+    // equivalent to it given the definitions collected on the way
+    std::vector<AST_node*> operands;
+    flattenChain(chain, operands, parity);
+
+    std::vector<AST_node*> literals;
+    for (AST_node* operand : operands)
+    {
+        AST_node* literal = literalFor(operand);
+        if (literal->token.type == CONSTANT)
+        {
+            parity ^= symbols.getConstValue(literal->token.lexeme) == CONST_TRUE;
+            AST::deleteTree(literal);
+        }
+        else
+        {
+            literals.push_back(literal);
+        }
+    }
+
+    // Replace the front chunk with an aux variable at the back until the rest fits, which yields a balanced tree of
+    // chunks rather than a long ladder
+    size_t front = 0;
+    while (literals.size() - front > chunk_size)
+    {
+        std::vector<AST_node*> chunk(literals.begin() + front, literals.begin() + front + chunk_size);
+        bool is_new = false;
+        AST_node* aux = auxFor(parityKey(chunk, false), is_new);
+        if (is_new)
+        {
+            chunk.push_back(aux);
+            definitions.push_back(expandParity(chunk, true)); // aux<=>(chunk)
+        }
+        for (size_t i=0; i<chunk_size; i++)
+        {
+            AST::deleteTree(literals[front + i]);
+        }
+        front += chunk_size;
+        literals.push_back(aux);
+    }
+    return std::vector<AST_node*>(literals.begin() + front, literals.end());
+}
+
+AST_node* ParityEncoder::literalFor(AST_node* curr)
+{
+    // Takes ownership of curr and returns a literal (or constant) that is equivalent to it given the definitions
+    if (curr->token.type != OPERATOR || isLiteral(curr))
+    {
+        return curr;
+    }
+
+    if (isChain(curr))
+    {
+        bool parity = false;
+        std::vector<AST_node*> literals = chainLiterals(curr, parity);
+        if (literals.empty())
+        {
+            return new AST_node(Token(CONSTANT, symbols.getConstLexeme(parity ? CONST_TRUE : CONST_FALSE)));
+        }
+        if (literals.size() == 1)
+        {
+            return parity ? makeNot(literals[0]) : literals[0];
+        }
+
+        bool is_new = false;
+        AST_node* aux = auxFor(parityKey(literals, parity), is_new);
+        if (is_new)
+        {
+            literals.push_back(deep_copy(aux));
+            definitions.push_back(expandParity(literals, !parity)); // aux<=>(literals^parity)
+        }
+        for (AST_node* literal : literals)
+        {
+            AST::deleteTree(literal);
+        }
+        return aux;
+    }
+
+    OperatorKind kind = ops.getProperties(curr->token.lexeme).kind;
+    std::vector<AST_node*> children = curr->children;
+    curr->children.clear();
+    delete curr;
+    if (kind == OP_NOT)
+    {
+        return makeNot(literalFor(children[0]));
+    }
+
+    AST_node* left = literalFor(children[0]);
+    AST_node* right = literalFor(children[1]);
+    if (kind == OP_IMPLIES)
+    {
+        left = makeNot(left); // a=>b is !a+b
+        kind = OP_OR;
+    }
+
+    bool is_new = false;
+    AST_node* aux = auxFor(ops.getLexeme(kind) + "(" + subtreeKey(left) + "," + subtreeKey(right) + ",)", is_new);
+    if (is_new)
+    {
+        // aux<=>left*right is (!aux+left)*(!aux+right)*(aux+!left+!right), and aux<=>left+right is the same with
+        // every literal negated
+        const bool conjunction = kind == OP_AND;
+        auto copy = [this](const AST_node* literal, bool negate)
+        {
+            AST_node* result = deep_copy(literal);
+            return negate ? makeNot(result) : result;
+        };
+        AST_node* definition = makeBinary(OP_AND,
+                                          makeBinary(OP_OR, copy(aux, conjunction), copy(left, !conjunction)),
+                                          makeBinary(OP_OR, copy(aux, conjunction), copy(right, !conjunction)));
+        definition = makeBinary(OP_AND, definition,
+                                makeBinary(OP_OR, makeBinary(OP_OR, copy(aux, !conjunction), copy(left, conjunction)),
+                                           copy(right, conjunction)));
+        definitions.push_back(definition);
+    }
+    AST::deleteTree(left);
+    AST::deleteTree(right);
+    return aux;
+}
+
+void ParityEncoder::flattenChain(AST_node* curr, std::vector<AST_node*>& operands, bool& parity) const
+{
+    if (!isChain(curr))
+    {
+        operands.push_back(curr);
+        return;
+    }
+
+    if (ops.getProperties(curr->token.lexeme).kind != OP_XOR)
+    {
+        parity = !parity; // a<=>b is a^b^1, and !a is a^1
+    }
+    for (AST_node* child : curr->children)
+    {
+        flattenChain(child, operands, parity);
+    }
+
+    // The operands now belong to the caller, so only this chain node is freed
+    curr->children.clear();
+    delete curr;
+}
+
+AST_node* ParityEncoder::auxFor(const std::string& key, bool& is_new)
+{
+    auto it = aux_variables.find(key);
+    if (it != aux_variables.end())
+    {
+        is_new = false;
+        return new AST_node(Token(VARIABLE, it->second));
+    }
+
+    it = pending_aux_variables.find(key);
+    is_new = it == pending_aux_variables.end();
+    if (is_new)
+    {
+        it = pending_aux_variables.insert({key, "_t" + std::to_string(next_aux++)}).first;
+    }
+    return new AST_node(Token(VARIABLE, it->second));
+}
+
+std::string ParityEncoder::parityKey(const std::vector<AST_node*>& literals, const bool parity)
+{
+    // XOR is commutative, so the key is built from the sorted literals
+    std::vector<std::string> keys;
+    for (const AST_node* literal : literals)
+    {
+        keys.push_back(subtreeKey(literal));
+    }
+    std::sort(keys.begin(), keys.end());
+    std::string key = parity ? "^1(" : "^(";
+    for (const std::string& literal_key : keys)
+    {
+        key += literal_key + ",";
+    }
+    return key + ")";
+}
+
+std::string ParityEncoder::subtreeKey(const AST_node* curr)
+{
+    if (curr->children.empty())
+    {
+        return curr->token.lexeme;
+    }
+
+    std::string key = curr->token.lexeme + "(";
+    for (const AST_node* child : curr->children)
+    {
+        key += subtreeKey(child) + ",";
+    }
+    return key + ")";
+}
+
+AST_node* ParityEncoder::makeNot(AST_node* operand) const
+{
+    if (operand->token.type == CONSTANT)
+    {
+        bool value = symbols.getConstValue(operand->token.lexeme) == CONST_TRUE;
+        operand->token.lexeme = symbols.getConstLexeme(value ? CONST_FALSE : CONST_TRUE);
+        return operand;
+    }
+
+    // Negating an already negated literal just strips the negation to keep clauses flat
+    if (isLiteral(operand) && operand->token.type == OPERATOR)
+    {
+        AST_node* inner = operand->children[0];
+        operand->children.clear();
+        delete operand;
+        return inner;
+    }
+
+    AST_node* node = new AST_node(Token(OPERATOR, ops.getLexeme(OP_NOT)));
+    node->children.push_back(operand);
+    return node;
+}
+
+AST_node* ParityEncoder::makeBinary(OperatorKind kind, AST_node* left, AST_node* right) const
+{
+    AST_node* node = new AST_node(Token(OPERATOR, ops.getLexeme(kind)));
+    node->children.push_back(left);
+    node->children.push_back(right);
+    return node;
+}
+
+AST_node* ParityEncoder::expandParity(const std::vector<AST_node*>& operands, bool parity) const
+{
+    // Builds the CNF of operands[0]^operands[1]^...^parity. The formula is false exactly for the assignments whose
+    // parity equals the constant, so each of those gets one clause that rules it out. The operands are copied.
+    if (operands.empty())
+    {
+        return new AST_node(Token(CONSTANT, symbols.getConstLexeme(parity ? CONST_TRUE : CONST_FALSE)));
+    }
+
+    AST_node* cnf = nullptr;
+    for (unsigned long assignment=0; assignment < (1UL << operands.size()); assignment++)
+    {
+        bool assignment_parity = false;
+        for (size_t i=0; i<operands.size(); i++)
+        {
+            assignment_parity ^= ((assignment >> i) & 1) != 0;
+        }
+        if (assignment_parity != parity)
+        {
+            continue;
+        }
+
+        AST_node* clause = nullptr;
+        for (size_t i=0; i<operands.size(); i++)
+        {
+            AST_node* literal = deep_copy(operands[i]);
+            if ((assignment >> i) & 1)
+            {
+                literal = makeNot(literal);
+            }
+            clause = clause ? makeBinary(OP_OR, clause, literal) : literal;
+        }
+        cnf = cnf ? makeBinary(OP_AND, cnf, clause) : clause;
+    }
+    return cnf;
+}
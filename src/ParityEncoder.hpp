@@ -0,0 +1,64 @@
+#ifndef WFF2CNF_PARITYENCODER_HPP
+#define WFF2CNF_PARITYENCODER_HPP
+
+#include "AST.hpp"
+#include "Operators.hpp"
+#include "Symbols.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ParityEncoder removes the XOR (^) and IFF (<=>) operators from a WFF before it is handed to the Transformer.
+//
+// Expanding a<=>b into (a=>b)*(b=>a) copies both operands, so nested parity chains grow exponentially. Instead, every
+// maximal chain of ^, <=> and ! is flattened into a list of operands plus a constant parity (a<=>b is a^b^1, !a is
+// a^1):
+//   - Operands that are not literals are turned into literals Tseitin-style: every gate (*, +, =>, or a nested chain)
+//     inside them gets its own auxiliary variable z, and the definition z<=>gate, which only ever mentions literals,
+//     is conjoined onto the root of the WFF. No definition ever negates a formula that was already expanded.
+//   - Chains longer than chunk_size are cut into chunks; each chunk is replaced by an auxiliary variable t defined by
+//     t<=>(chunk), so no clause set is wider than 2^chunk_size clauses.
+//   - What remains is expanded in place into its direct CNF encoding (every clause that rules out one assignment of
+//     the wrong parity). A chain in negative position (under a ! or on the left of =>) is replaced by an auxiliary
+//     variable instead, since the Transformer would otherwise have to negate its expansion.
+//
+// Chains made only of a few literals in positive position are encoded without any auxiliary variable, so the result is
+// equivalent to the input. Otherwise it is equisatisfiable, and auxiliary variables are named "_t1", "_t2", ... which
+// can never clash with a user variable.
+//
+// Passing reuse_definitions to encode() lets a gate or chunk that was already given an aux variable by an earlier
+// call reuse it without repeating its definition. That is only sound when the earlier results are conjoined with this
+// one, as the CNFBuilder does, so the aux variables of a call only become reusable once commitDefinitions() confirms
+// that its result was kept. Until then the next call to encode() forgets them.
+class ParityEncoder
+{
+private:
+    const Symbols symbols;
+    const Operators ops;
+    const size_t chunk_size;
+    size_t next_aux = 1;
+    std::vector<AST_node*> definitions;
+    std::unordered_map<std::string,std::string> aux_variables; // Subformula key -> aux variable that already defines it
+    std::unordered_map<std::string,std::string> pending_aux_variables; // Same, for the last call until it is committed
+
+    bool isChain(const AST_node*) const;
+    bool isLiteral(const AST_node*) const;
+    void encodeNode(AST_node*&, bool);
+    void flattenChain(AST_node*, std::vector<AST_node*>&, bool&) const;
+    std::vector<AST_node*> chainLiterals(AST_node*, bool&);
+    AST_node* literalFor(AST_node*);
+    AST_node* auxFor(const std::string&, bool&);
+    static std::string parityKey(const std::vector<AST_node*>&, bool);
+    static std::string subtreeKey(const AST_node*);
+    AST_node* makeNot(AST_node*) const;
+    AST_node* makeBinary(OperatorKind, AST_node*, AST_node*) const;
+    AST_node* expandParity(const std::vector<AST_node*>&, bool) const;
+
+public:
+    ParityEncoder(const Symbols&, const Operators&, size_t chunk_size = 4);
+
+    void encode(AST&, bool reuse_definitions = false);
+    void commitDefinitions();
+};
+
+#endif //WFF2CNF_PARITYENCODER_HPP
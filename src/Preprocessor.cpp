@@ -0,0 +1,385 @@
+#include "Preprocessor.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+
+Preprocessor::Preprocessor(const std::vector<Clause>& _clauses, const int _num_variables)
+    : num_variables(_num_variables),
+      occurrences(2 * (_num_variables + 1)),
+      values(_num_variables + 1, 0),
+      frozen(_num_variables + 1, false),
+      eliminated(_num_variables + 1, false),
+      marks(_num_variables + 1, 0)
+{
+    for (const Clause& clause : _clauses)
+    {
+        for (int literal : clause)
+        {
+            if (literal == 0 || std::abs(literal) > num_variables)
+            {
+                throw std::runtime_error("Literal " + std::to_string(literal) + " out of range in Preprocessor()");
+            }
+        }
+        addClause(clause);
+    }
+}
+
+void Preprocessor::freeze(const int variable)
+{
+    frozen.at(std::abs(variable)) = true;
+}
+
+size_t Preprocessor::literalIndex(const int literal) const
+{
+    return 2 * std::abs(literal) + (literal < 0 ? 1 : 0);
+}
+
+int8_t Preprocessor::valueOf(const int literal) const
+{
+    int8_t value = values[std::abs(literal)];
+    return literal < 0 ? -value : value;
+}
+
+void Preprocessor::addClause(Clause clause)
+{
+    // Sorting by variable puts v and -v next to each other, so duplicates and tautologies are found in one sweep
+    std::sort(clause.begin(), clause.end(), [](int a, int b)
+    {
+        return std::abs(a) < std::abs(b) || (std::abs(a) == std::abs(b) && a < b);
+    });
+    clause.erase(std::unique(clause.begin(), clause.end()), clause.end());
+
+    Clause kept;
+    for (size_t i=0; i<clause.size(); i++)
+    {
+        if ((i > 0 && clause[i] == -clause[i-1]) || valueOf(clause[i]) == 1)
+        {
+            return; // Always satisfied
+        }
+        if (valueOf(clause[i]) == 0)
+        {
+            kept.push_back(clause[i]);
+        }
+    }
+
+    if (kept.empty())
+    {
+        unsatisfiable = true;
+        return;
+    }
+    if (kept.size() == 1)
+    {
+        units.push_back(kept[0]);
+    }
+
+    size_t id = clauses.size();
+    for (int literal : kept)
+    {
+        occurrences[literalIndex(literal)].push_back(id);
+    }
+    clauses.push_back(std::move(kept));
+    removed.push_back(false);
+}
+
+void Preprocessor::removeClause(const size_t id)
+{
+    removed[id] = true;
+    for (int literal : clauses[id])
+    {
+        std::vector<size_t>& list = occurrences[literalIndex(literal)];
+        list.erase(std::find(list.begin(), list.end(), id));
+    }
+}
+
+void Preprocessor::removeLiteral(const size_t id, const int literal)
+{
+    Clause& clause = clauses[id];
+    clause.erase(std::find(clause.begin(), clause.end(), literal));
+    std::vector<size_t>& list = occurrences[literalIndex(literal)];
+    list.erase(std::find(list.begin(), list.end(), id));
+
+    if (clause.empty())
+    {
+        unsatisfiable = true;
+    }
+    else if (clause.size() == 1)
+    {
+        units.push_back(clause[0]);
+    }
+}
+
+void Preprocessor::assign(const int literal)
+{
+    values[std::abs(literal)] = literal > 0 ? 1 : -1;
+    reconstruction.push_back({literal, {literal}});
+
+    std::vector<size_t> satisfied = occurrences[literalIndex(literal)];
+    for (size_t id : satisfied)
+    {
+        removeClause(id);
+    }
+    std::vector<size_t> falsified = occurrences[literalIndex(-literal)];
+    for (size_t id : falsified)
+    {
+        removeLiteral(id, -literal);
+    }
+}
+
+bool Preprocessor::propagate()
+{
+    while (!units.empty() && !unsatisfiable)
+    {
+        int literal = units.back();
+        units.pop_back();
+        if (valueOf(literal) == -1)
+        {
+            unsatisfiable = true;
+        }
+        else if (valueOf(literal) == 0)
+        {
+            assign(literal);
+        }
+    }
+    return !unsatisfiable;
+}
+
+void Preprocessor::eliminatePureLiterals()
+{
+    // Fixing a pure literal removes clauses, which can make other literals pure, so repeat until nothing changes
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int v=1; v<=num_variables; v++)
+        {
+            if (values[v] != 0 || frozen[v] || eliminated[v])
+            {
+                continue;
+            }
+            bool has_positive = !occurrences[literalIndex(v)].empty();
+            bool has_negative = !occurrences[literalIndex(-v)].empty();
+            if (has_positive != has_negative)
+            {
+                assign(has_positive ? v : -v);
+                changed = true;
+            }
+        }
+    }
+}
+
+size_t Preprocessor::eliminationCost(const int variable) const
+{
+    return occurrences[literalIndex(variable)].size() * occurrences[literalIndex(-variable)].size();
+}
+
+bool Preprocessor::tryEliminate(const int variable)
+{
+    const std::vector<size_t> positive = occurrences[literalIndex(variable)];
+    const std::vector<size_t> negative = occurrences[literalIndex(-variable)];
+    if (positive.empty() || negative.empty() || positive.size() > MAX_OCCURRENCES || negative.size() > MAX_OCCURRENCES)
+    {
+        return false;
+    }
+
+    // Only eliminate if the non-tautological resolvents don't outnumber the clauses they replace
+    const size_t limit = positive.size() + negative.size();
+    std::vector<Clause> resolvents;
+    bool within_limits = true;
+    for (size_t p : positive)
+    {
+        for (int literal : clauses[p])
+        {
+            marks[std::abs(literal)] = literal > 0 ? 1 : -1;
+        }
+
+        for (size_t n : negative)
+        {
+            Clause resolvent;
+            bool tautology = false;
+            for (int literal : clauses[p])
+            {
+                if (literal != variable)
+                {
+                    resolvent.push_back(literal);
+                }
+            }
+            for (int literal : clauses[n])
+            {
+                int8_t mark = marks[std::abs(literal)];
+                if (literal == -variable || mark == (literal > 0 ? 1 : -1))
+                {
+                    continue;
+                }
+                if (mark != 0)
+                {
+                    tautology = true;
+                    break;
+                }
+                resolvent.push_back(literal);
+            }
+
+            if (!tautology)
+            {
+                if (resolvent.size() > MAX_RESOLVENT_SIZE || resolvents.size() == limit)
+                {
+                    within_limits = false;
+                    break;
+                }
+                resolvents.push_back(std::move(resolvent));
+            }
+        }
+
+        // marks is shared by every candidate, so it has to be all zero again before any return
+        for (int literal : clauses[p])
+        {
+            marks[std::abs(literal)] = 0;
+        }
+        if (!within_limits)
+        {
+            return false;
+        }
+    }
+
+    for (size_t id : positive)
+    {
+        reconstruction.push_back({variable, clauses[id]});
+        removeClause(id);
+    }
+    for (size_t id : negative)
+    {
+        reconstruction.push_back({-variable, clauses[id]});
+        removeClause(id);
+    }
+    eliminated[variable] = true;
+
+    for (Clause& resolvent : resolvents)
+    {
+        addClause(std::move(resolvent));
+    }
+    return true;
+}
+
+bool Preprocessor::run()
+{
+    if (!propagate())
+    {
+        return false;
+    }
+    eliminatePureLiterals();
+
+    typedef std::pair<size_t,int> Candidate; // Elimination cost, variable
+    std::priority_queue<Candidate,std::vector<Candidate>,std::greater<Candidate>> queue;
+    for (int v=1; v<=num_variables; v++)
+    {
+        queue.push({eliminationCost(v), v});
+    }
+
+    while (!queue.empty())
+    {
+        Candidate candidate = queue.top();
+        queue.pop();
+        int v = candidate.second;
+        if (values[v] != 0 || frozen[v] || eliminated[v])
+        {
+            continue;
+        }
+
+        // Costs go stale as clauses change, so re-queue instead of eliminating a variable that is no longer cheapest
+        size_t cost = eliminationCost(v);
+        if (cost != candidate.first)
+        {
+            queue.push({cost, v});
+            continue;
+        }
+
+        std::vector<int> neighbours;
+        for (int literal : {v, -v})
+        {
+            for (size_t id : occurrences[literalIndex(literal)])
+            {
+                for (int other : clauses[id])
+                {
+                    neighbours.push_back(std::abs(other));
+                }
+            }
+        }
+
+        if (tryEliminate(v))
+        {
+            if (!propagate())
+            {
+                return false;
+            }
+            std::sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+            for (int neighbour : neighbours)
+            {
+                if (values[neighbour] == 0 && !eliminated[neighbour])
+                {
+                    queue.push({eliminationCost(neighbour), neighbour});
+                }
+            }
+        }
+    }
+
+    return !unsatisfiable;
+}
+
+std::vector<Clause> Preprocessor::getClauses() const
+{
+    if (unsatisfiable)
+    {
+        return {Clause()};
+    }
+
+    std::vector<Clause> result;
+    for (size_t id=0; id<clauses.size(); id++)
+    {
+        if (!removed[id])
+        {
+            result.push_back(clauses[id]);
+        }
+    }
+
+    // Assigned variables have no clauses left, so their units keep them fixed for any clauses the caller adds later
+    for (int v=1; v<=num_variables; v++)
+    {
+        if (values[v] != 0)
+        {
+            result.push_back({values[v] > 0 ? v : -v});
+        }
+    }
+    return result;
+}
+
+std::vector<bool> Preprocessor::extendModel(std::vector<bool> model) const
+{
+    model.resize(num_variables + 1, false);
+
+    // Undo the removals newest first: whenever a removed clause is not satisfied, its witness literal is made true
+    for (auto it = reconstruction.rbegin(); it != reconstruction.rend(); ++it)
+    {
+        bool satisfied = false;
+        for (int literal : it->second)
+        {
+            if (model[std::abs(literal)] == (literal > 0))
+            {
+                satisfied = true;
+                break;
+            }
+        }
+        if (!satisfied)
+        {
+            model[std::abs(it->first)] = it->first > 0;
+        }
+    }
+    return model;
+}
+
+int Preprocessor::getNumEliminated() const
+{
+    return static_cast<int>(std::count(eliminated.begin(), eliminated.end(), true));
+}
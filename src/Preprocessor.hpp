@@ -0,0 +1,61 @@
+#ifndef WFF2CNF_PREPROCESSOR_HPP
+#define WFF2CNF_PREPROCESSOR_HPP
+
+#include "Clause.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Preprocessor shrinks a clause set (e.g. from CNFBuilder) before it goes to a SAT solver, in the style of SatELite:
+//   - unit propagation, which fixes variables and removes satisfied clauses and false literals
+//   - pure literal elimination, which fixes variables that only ever occur with one sign
+//   - bounded variable elimination, which replaces every clause with v or !v by their non-tautological resolvents
+//     whenever that does not increase the number of clauses. Candidates are taken from a priority queue ordered by
+//     occurrences(v) * occurrences(!v), so the cheapest variables go first.
+//
+// The result is equisatisfiable, and every removed clause is kept on a reconstruction stack together with the literal
+// that was removed from it. extendModel() turns a model of the reduced clauses into a model of the original ones.
+// Variables that will appear in clauses added later (e.g. by an incremental CNFBuilder) must be frozen first. Variables
+// fixed by propagation or pure literal elimination stay in getClauses() as unit clauses.
+class Preprocessor
+{
+private:
+    static const size_t MAX_RESOLVENT_SIZE = 20;
+    static const size_t MAX_OCCURRENCES = 16; // Per sign, variables that occur more often are not worth resolving
+
+    const int num_variables;
+    std::vector<Clause> clauses;
+    std::vector<bool> removed;
+    std::vector<std::vector<size_t>> occurrences; // Indexed by literalIndex(), ids of the live clauses with the literal
+    std::vector<int8_t> values; // 1 true, -1 false, 0 unassigned
+    std::vector<bool> frozen;
+    std::vector<bool> eliminated;
+    std::vector<int8_t> marks; // Signs of the literals of the clause being resolved, all zero between tryEliminate() calls
+    std::vector<int> units;
+    std::vector<std::pair<int,Clause>> reconstruction; // Witness literal, removed clause
+    bool unsatisfiable = false;
+
+    size_t literalIndex(int) const;
+    int8_t valueOf(int) const;
+    void addClause(Clause);
+    void removeClause(size_t);
+    void removeLiteral(size_t, int);
+    void assign(int);
+    bool propagate();
+    void eliminatePureLiterals();
+    size_t eliminationCost(int) const;
+    bool tryEliminate(int);
+
+public:
+    Preprocessor(const std::vector<Clause>&, int num_variables);
+
+    void freeze(int);
+    bool run(); // Returns false if the clauses were found to be unsatisfiable
+
+    std::vector<Clause> getClauses() const;
+    std::vector<bool> extendModel(std::vector<bool>) const; // model[v] is the value of variable v, model[0] is unused
+    int getNumEliminated() const;
+};
+
+#endif //WFF2CNF_PREPROCESSOR_HPP
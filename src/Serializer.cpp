@@ -0,0 +1,387 @@
+#include "Serializer.hpp"
+#include "AST.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // Output targets for Serializer::writeNode(). BufferOut trusts the caller to have sized the buffer with length().
+    struct BufferOut
+    {
+        char* pos;
+
+        void append(const char* data, const size_t size)
+        {
+            std::memcpy(pos, data, size);
+            pos += size;
+        }
+
+        void append(const char c)
+        {
+            *pos++ = c;
+        }
+    };
+
+    // Grows a string geometrically and fills it in place, so toString() needs one traversal instead of a length pass
+    struct StringOut
+    {
+        std::string& result;
+        size_t used = 0;
+
+        explicit StringOut(std::string& _result) : result(_result) {}
+
+        void reserve(const size_t size)
+        {
+            if (used + size > result.size())
+            {
+                result.resize(std::max(result.size() * 2, used + size));
+            }
+        }
+
+        void append(const char* data, const size_t size)
+        {
+            reserve(size);
+            std::memcpy(&result[used], data, size);
+            used += size;
+        }
+
+        void append(const char c)
+        {
+            reserve(1);
+            result[used++] = c;
+        }
+    };
+
+    template<typename Flush>
+    struct ChunkOut
+    {
+        std::vector<char> chunk;
+        size_t used = 0;
+        Flush flush;
+
+        ChunkOut(const size_t size, Flush _flush) : chunk(size), flush(_flush) {}
+
+        void append(const char* data, size_t size)
+        {
+            while (size > 0)
+            {
+                if (used == chunk.size())
+                {
+                    drain();
+                }
+                size_t n = std::min(size, chunk.size() - used);
+                std::memcpy(chunk.data() + used, data, n);
+                used += n;
+                data += n;
+                size -= n;
+            }
+        }
+
+        void append(const char c)
+        {
+            if (used == chunk.size())
+            {
+                drain();
+            }
+            chunk[used++] = c;
+        }
+
+        void drain()
+        {
+            flush(chunk.data(), used);
+            used = 0;
+        }
+    };
+
+    template<typename Flush>
+    ChunkOut<Flush> makeChunkOut(const size_t size, Flush flush)
+    {
+        return ChunkOut<Flush>(size, flush);
+    }
+}
+
+Serializer::Serializer(const Operators& ops)
+{
+    for (const std::string& lexeme : ops.getLexemes())
+    {
+        const OperationProperties& properties = ops.getProperties(lexeme);
+        table.push_back({lexeme, properties.arity == UNARY, properties.associativity == ASSOCIATIVE});
+    }
+}
+
+int Serializer::lookup(const std::string& lexeme) const
+{
+    for (size_t i=0; i<table.size(); i++)
+    {
+        if (table[i].lexeme.size() == lexeme.size() && table[i].lexeme == lexeme)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    throw std::runtime_error("Unknown operator '" + lexeme + "' found in Serializer.lookup()");
+}
+
+bool Serializer::needsParens(const int parent, const int child_entry) const
+{
+    // Binary operands need parentheses unless they chain the same associative operator as their parent
+    return parent >= 0
+           && child_entry >= 0
+           && !table[child_entry].unary
+           && (parent != child_entry || !table[child_entry].associative);
+}
+
+size_t Serializer::length(const AST_node* root) const
+{
+    return nodeLength(root, root->token.type == OPERATOR ? lookup(root->token.lexeme) : -1);
+}
+
+size_t Serializer::nodeLength(const AST_node* curr, const int entry) const
+{
+    size_t total = curr->token.lexeme.size();
+    for (const AST_node* child : curr->children)
+    {
+        int child_entry = child->token.type == OPERATOR ? lookup(child->token.lexeme) : -1;
+        total += nodeLength(child, child_entry) + (needsParens(entry, child_entry) ? 2 : 0);
+    }
+    return total;
+}
+
+template<typename Out>
+void Serializer::writeNode(const AST_node* curr, const int entry, Out& out) const
+{
+    // Unary operators go before their operand, binary ones between their two operands
+    bool operator_written = false;
+    if (entry >= 0 && table[entry].unary)
+    {
+        out.append(curr->token.lexeme.data(), curr->token.lexeme.size());
+        operator_written = true;
+    }
+    if (entry < 0)
+    {
+        out.append(curr->token.lexeme.data(), curr->token.lexeme.size());
+    }
+
+    for (const AST_node* child : curr->children)
+    {
+        int child_entry = child->token.type == OPERATOR ? lookup(child->token.lexeme) : -1;
+        bool parens = needsParens(entry, child_entry);
+        if (parens)
+        {
+            out.append('(');
+        }
+        writeNode(child, child_entry, out);
+        if (parens)
+        {
+            out.append(')');
+        }
+        if (!operator_written)
+        {
+            out.append(curr->token.lexeme.data(), curr->token.lexeme.size());
+            operator_written = true;
+        }
+    }
+}
+
+size_t Serializer::write(const AST_node* root, char* buffer) const
+{
+    BufferOut out = {buffer};
+    writeNode(root, root->token.type == OPERATOR ? lookup(root->token.lexeme) : -1, out);
+    return out.pos - buffer;
+}
+
+std::string Serializer::toString(const AST_node* root) const
+{
+    std::string result(64, '\0');
+    StringOut out(result);
+    writeNode(root, root->token.type == OPERATOR ? lookup(root->token.lexeme) : -1, out);
+    result.resize(out.used);
+    return result;
+}
+
+void Serializer::splitNode(const AST_node* curr, const int entry, std::vector<Piece>& pieces) const
+{
+    // Same layout as writeNode(), one level deep, with the operands left as subtrees
+    static const char OPEN[] = "(";
+    static const char CLOSE[] = ")";
+    if (entry < 0)
+    {
+        pieces.push_back({nullptr, -1, curr->token.lexeme.data(), curr->token.lexeme.size()});
+        return;
+    }
+
+    bool operator_written = false;
+    if (table[entry].unary)
+    {
+        pieces.push_back({nullptr, -1, curr->token.lexeme.data(), curr->token.lexeme.size()});
+        operator_written = true;
+    }
+    for (const AST_node* child : curr->children)
+    {
+        int child_entry = child->token.type == OPERATOR ? lookup(child->token.lexeme) : -1;
+        bool parens = needsParens(entry, child_entry);
+        if (parens)
+        {
+            pieces.push_back({nullptr, -1, OPEN, 1});
+        }
+        pieces.push_back({child, child_entry, nullptr, 0});
+        if (parens)
+        {
+            pieces.push_back({nullptr, -1, CLOSE, 1});
+        }
+        if (!operator_written)
+        {
+            pieces.push_back({nullptr, -1, curr->token.lexeme.data(), curr->token.lexeme.size()});
+            operator_written = true;
+        }
+    }
+}
+
+std::string Serializer::toStringParallel(const AST_node* root, const unsigned threads) const
+{
+    if (threads <= 1)
+    {
+        return toString(root);
+    }
+
+    // Split the subtrees level by level until there are enough of them to keep every thread busy
+    std::vector<Piece> pieces = {{root, root->token.type == OPERATOR ? lookup(root->token.lexeme) : -1, nullptr, 0}};
+    size_t num_subtrees = 1;
+    for (int round=0; round<MAX_SPLIT_ROUNDS && num_subtrees > 0 && num_subtrees < threads * PIECES_PER_THREAD; round++)
+    {
+        std::vector<Piece> split;
+        for (const Piece& piece : pieces)
+        {
+            if (piece.node)
+            {
+                splitNode(piece.node, piece.entry, split);
+            }
+            else
+            {
+                split.push_back(piece);
+            }
+        }
+        pieces.swap(split);
+        num_subtrees = 0;
+        for (const Piece& piece : pieces)
+        {
+            num_subtrees += piece.node != nullptr;
+        }
+    }
+    if (num_subtrees <= 1)
+    {
+        return toString(root);
+    }
+
+    // Batches are runs of consecutive pieces with about the same number of subtrees each
+    const size_t num_batches = std::min<size_t>(num_subtrees, threads * BATCHES_PER_THREAD);
+    std::vector<size_t> batch_begin = {0};
+    size_t seen = 0;
+    for (size_t i=0; i<pieces.size(); i++)
+    {
+        seen += pieces[i].node != nullptr;
+        if (seen * num_batches >= num_subtrees * batch_begin.size() && batch_begin.size() < num_batches)
+        {
+            batch_begin.push_back(i + 1);
+        }
+    }
+    batch_begin.push_back(pieces.size());
+
+    std::vector<std::string> batches(batch_begin.size() - 1);
+    std::vector<size_t> offsets(batches.size() + 1, 0);
+    std::string result;
+    std::atomic<size_t> next_batch(0);
+    auto runWorkers = [&](auto&& work)
+    {
+        next_batch = 0;
+        auto worker = [&]()
+        {
+            for (size_t b = next_batch++; b < batches.size(); b = next_batch++)
+            {
+                work(b);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t=1; t<threads; t++)
+        {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& t : workers)
+        {
+            t.join();
+        }
+    };
+
+    runWorkers([&](const size_t b)
+    {
+        StringOut out(batches[b]);
+        for (size_t i=batch_begin[b]; i<batch_begin[b + 1]; i++)
+        {
+            if (pieces[i].node)
+            {
+                writeNode(pieces[i].node, pieces[i].entry, out);
+            }
+            else
+            {
+                out.append(pieces[i].text, pieces[i].size);
+            }
+        }
+        batches[b].resize(out.used);
+    });
+
+    for (size_t b=0; b<batches.size(); b++)
+    {
+        offsets[b + 1] = offsets[b] + batches[b].size();
+    }
+    result.resize(offsets.back());
+    runWorkers([&](const size_t b)
+    {
+        std::memcpy(&result[offsets[b]], batches[b].data(), batches[b].size());
+        std::string().swap(batches[b]);
+    });
+    return result;
+}
+
+void Serializer::write(const AST_node* root, std::ostream& os) const
+{
+    auto out = makeChunkOut(CHUNK_SIZE, [&os](const char* data, size_t size)
+    {
+        os.write(data, size);
+    });
+    writeNode(root, root->token.type == OPERATOR ? lookup(root->token.lexeme) : -1, out);
+    out.drain();
+}
+
+#ifndef _WIN32
+void Serializer::write(const AST_node* root, const int fd) const
+{
+    auto out = makeChunkOut(CHUNK_SIZE, [fd](const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (written < 0)
+            {
+                throw std::runtime_error(std::string("Write failed in Serializer.write(): ") + std::strerror(errno));
+            }
+            data += written;
+            size -= written;
+        }
+    });
+    writeNode(root, root->token.type == OPERATOR ? lookup(root->token.lexeme) : -1, out);
+    out.drain();
+}
+#endif
@@ -0,0 +1,69 @@
+#ifndef WFF2CNF_SERIALIZER_HPP
+#define WFF2CNF_SERIALIZER_HPP
+
+#include "Operators.hpp"
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct AST_node;
+
+// Serializer prints a WFF in infix form (AST::toString() is built on it) without any intermediate strings or streams.
+//
+// The operators are copied into a small table when the Serializer is built, so printing a node costs one short scan
+// of that table instead of several hash lookups, and a node's table entry is handed down to its children for the
+// parenthesis decisions. length() gives the exact output size so a caller can write into one preallocated buffer;
+// toString() skips that extra traversal and fills a geometrically grown string instead, and large outputs can be
+// streamed through a fixed-size chunk to an ostream or a file descriptor.
+//
+// toStringParallel() never measures anything up front. It splits the top levels of the tree into a sequence of text
+// pieces (operators and parentheses) and subtrees, a few dozen subtrees per thread. Consecutive pieces are grouped into
+// batches, and worker threads pick the batches up one at a time and write each into its own string. Those strings are
+// then copied into place at offsets given by prefix sums of their lengths.
+class Serializer
+{
+private:
+    struct OperatorEntry
+    {
+        std::string lexeme;
+        bool unary;
+        bool associative;
+    };
+
+    // Either a subtree to write or a piece of text (an operator or a parenthesis) between subtrees
+    struct Piece
+    {
+        const AST_node* node;
+        int entry;
+        const char* text;
+        size_t size;
+    };
+
+    static const size_t CHUNK_SIZE = 1 << 16;
+    static const size_t PIECES_PER_THREAD = 64; // Subtrees to split the tree into per thread, so the load evens out
+    static const size_t BATCHES_PER_THREAD = 8;
+    static const int MAX_SPLIT_ROUNDS = 32;
+
+    std::vector<OperatorEntry> table;
+
+    int lookup(const std::string&) const;
+    bool needsParens(int, int) const;
+    size_t nodeLength(const AST_node*, int) const;
+    template<typename Out>
+    void writeNode(const AST_node*, int, Out&) const;
+    void splitNode(const AST_node*, int, std::vector<Piece>&) const;
+
+public:
+    explicit Serializer(const Operators&);
+
+    size_t length(const AST_node*) const;
+    size_t write(const AST_node*, char*) const; // The buffer must hold at least length() chars, returns chars written
+    std::string toString(const AST_node*) const;
+    std::string toStringParallel(const AST_node*, unsigned threads) const;
+    void write(const AST_node*, std::ostream&) const;
+#ifndef _WIN32
+    void write(const AST_node*, int fd) const;
+#endif
+};
+
+#endif //WFF2CNF_SERIALIZER_HPP
@@ -0,0 +1,235 @@
+#include "Simplifier.hpp"
+
+Simplifier::Simplifier(const Symbols& _symbols, const Operators& _ops)
+    : symbols(_symbols),
+      ops(_ops)
+    {}
+
+void Simplifier::simplify(AST& wff) const
+{
+    simplifySubtree(wff.getMutableRoot());
+}
+
+void Simplifier::simplifySubtree(AST_node* curr) const
+{
+    if (curr->token.type != OPERATOR)
+    {
+        return;
+    }
+
+    // The left operand goes first, so a right operand that an absorbing left one makes irrelevant (0*b, 1+b, 0=>b) is
+    // deleted without being simplified
+    simplifySubtree(curr->children[0]);
+    if (curr->children.size() == 2)
+    {
+        const OperatorKind kind = ops.getProperties(curr->token.lexeme).kind;
+        const ConstantValue left_value = constValue(curr->children[0]);
+        if ((kind == OP_AND && left_value == CONST_FALSE) || (kind == OP_OR && left_value == CONST_TRUE))
+        {
+            replaceWithConstant(curr, left_value);
+            return;
+        }
+        if (kind == OP_IMPLIES && left_value == CONST_FALSE)
+        {
+            replaceWithConstant(curr, CONST_TRUE);
+            return;
+        }
+        simplifySubtree(curr->children[1]);
+    }
+    foldNode(curr);
+}
+
+bool Simplifier::foldNode(AST_node* curr) const
+{
+    if (curr->token.type != OPERATOR)
+    {
+        return false;
+    }
+
+    const OperatorKind kind = ops.getProperties(curr->token.lexeme).kind;
+
+    if (kind == OP_NOT)
+    {
+        const AST_node* child = curr->children[0];
+        ConstantValue value = constValue(child);
+        if (value != CONST_NOT_FOUND)
+        {
+            replaceWithConstant(curr, value == CONST_TRUE ? CONST_FALSE : CONST_TRUE);
+            return true;
+        }
+        if (child->token.type == OPERATOR && ops.getProperties(child->token.lexeme).kind == OP_NOT)
+        {
+            replaceWithChild(curr, 0); // !!a -> !a
+            replaceWithChild(curr, 0); // !a -> a
+            return true;
+        }
+        return false;
+    }
+
+    const AST_node* left = curr->children[0];
+    const AST_node* right = curr->children[1];
+    const ConstantValue left_value = constValue(left);
+    const ConstantValue right_value = constValue(right);
+
+    switch (kind)
+    {
+        case OP_AND:
+            if (left_value == CONST_FALSE || right_value == CONST_FALSE || isComplement(left, right))
+            {
+                replaceWithConstant(curr, CONST_FALSE);
+            }
+            else if (left_value == CONST_TRUE)
+            {
+                replaceWithChild(curr, 1);
+            }
+            else if (right_value == CONST_TRUE || is_equal(left, right))
+            {
+                replaceWithChild(curr, 0);
+            }
+            else
+            {
+                return false;
+            }
+            return true;
+
+        case OP_OR:
+            if (left_value == CONST_TRUE || right_value == CONST_TRUE || isComplement(left, right))
+            {
+                replaceWithConstant(curr, CONST_TRUE);
+            }
+            else if (left_value == CONST_FALSE)
+            {
+                replaceWithChild(curr, 1);
+            }
+            else if (right_value == CONST_FALSE || is_equal(left, right))
+            {
+                replaceWithChild(curr, 0);
+            }
+            else
+            {
+                return false;
+            }
+            return true;
+
+        case OP_IMPLIES:
+            if (left_value == CONST_FALSE || right_value == CONST_TRUE || is_equal(left, right))
+            {
+                replaceWithConstant(curr, CONST_TRUE);
+            }
+            else if (left_value == CONST_TRUE || isComplement(left, right)) // !a=>a is a, a=>!a is !a
+            {
+                replaceWithChild(curr, 1);
+            }
+            else if (right_value == CONST_FALSE)
+            {
+                replaceWithNegatedChild(curr, 0);
+            }
+            else
+            {
+                return false;
+            }
+            return true;
+
+        case OP_XOR:
+        case OP_IFF:
+        {
+            // a<=>b is just a^b with the result flipped
+            const ConstantValue identity = kind == OP_XOR ? CONST_FALSE : CONST_TRUE;
+            const ConstantValue absorbing = kind == OP_XOR ? CONST_TRUE : CONST_FALSE;
+            if (is_equal(left, right))
+            {
+                replaceWithConstant(curr, identity);
+            }
+            else if (isComplement(left, right))
+            {
+                replaceWithConstant(curr, absorbing);
+            }
+            else if (left_value == identity)
+            {
+                replaceWithChild(curr, 1);
+            }
+            else if (left_value != CONST_NOT_FOUND)
+            {
+                replaceWithNegatedChild(curr, 1);
+            }
+            else if (right_value == identity)
+            {
+                replaceWithChild(curr, 0);
+            }
+            else if (right_value != CONST_NOT_FOUND)
+            {
+                replaceWithNegatedChild(curr, 0);
+            }
+            else
+            {
+                return false;
+            }
+            return true;
+        }
+
+        default:
+            return false;
+    }
+}
+
+ConstantValue Simplifier::constValue(const AST_node* curr) const
+{
+    if (curr->token.type != CONSTANT)
+    {
+        return CONST_NOT_FOUND;
+    }
+    return symbols.getConstValue(curr->token.lexeme);
+}
+
+bool Simplifier::isComplement(const AST_node* a, const AST_node* b) const
+{
+    if (a->token.type == OPERATOR && ops.getProperties(a->token.lexeme).kind == OP_NOT && is_equal(a->children[0], b))
+    {
+        return true;
+    }
+    return b->token.type == OPERATOR && ops.getProperties(b->token.lexeme).kind == OP_NOT && is_equal(b->children[0], a);
+}
+
+void Simplifier::replaceWithChild(AST_node* curr, const size_t index) const
+{
+    AST_node* child = curr->children[index];
+    for (size_t i=0; i<curr->children.size(); i++)
+    {
+        if (i != index)
+        {
+            AST::deleteTree(curr->children[i]);
+        }
+    }
+
+    // Move the child into curr so that pointers to curr stay valid, then free the child's now empty shell
+    curr->token = child->token;
+    curr->children.swap(child->children);
+    child->children.clear();
+    delete child;
+}
+
+void Simplifier::replaceWithConstant(AST_node* curr, const ConstantValue value) const
+{
+    for (AST_node* child : curr->children)
+    {
+        AST::deleteTree(child);
+    }
+    curr->children.clear();
+    curr->token = Token(CONSTANT, symbols.getConstLexeme(value));
+}
+
+void Simplifier::replaceWithNegatedChild(AST_node* curr, const size_t index) const
+{
+    AST_node* child = curr->children[index];
+    for (size_t i=0; i<curr->children.size(); i++)
+    {
+        if (i != index)
+        {
+            AST::deleteTree(curr->children[i]);
+        }
+    }
+
+    curr->token = Token(OPERATOR, ops.getLexeme(OP_NOT));
+    curr->children.assign(1, child);
+    foldNode(curr); // The child may itself be a constant or a negation
+}
@@ -0,0 +1,36 @@
+#ifndef WFF2CNF_SIMPLIFIER_HPP
+#define WFF2CNF_SIMPLIFIER_HPP
+
+#include "AST.hpp"
+#include "Operators.hpp"
+#include "Symbols.hpp"
+
+// Simplifier folds constants out of a WFF in one bottom-up traversal, using the values the Symbols assign to them
+// (a*1 -> a, a+1 -> 1, 1=>a -> a, a^1 -> !a, ...). It also collapses the complement and idempotence cases (a*!a -> 0,
+// a+!a -> 1, a*a -> a, a^a -> 0, ...). Operands are simplified left to right, and when the left operand of *, + or =>
+// folds to its absorbing constant the right one is deleted without being simplified.
+//
+// Nodes are rewritten in place, so pointers held by a caller stay valid. foldNode() only looks at a single node whose
+// children are already simplified, which lets the Transformer re-simplify just the subtree it rewrote plus the path
+// back up to the root.
+class Simplifier
+{
+private:
+    const Symbols symbols;
+    const Operators ops;
+
+    ConstantValue constValue(const AST_node*) const;
+    bool isComplement(const AST_node*, const AST_node*) const;
+    void replaceWithChild(AST_node*, size_t) const;
+    void replaceWithConstant(AST_node*, ConstantValue) const;
+    void replaceWithNegatedChild(AST_node*, size_t) const;
+
+public:
+    Simplifier(const Symbols&, const Operators&);
+
+    void simplify(AST&) const;
+    void simplifySubtree(AST_node*) const;
+    bool foldNode(AST_node*) const;
+};
+
+#endif //WFF2CNF_SIMPLIFIER_HPP
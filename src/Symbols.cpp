@@ -4,6 +4,8 @@
 
 #include "Symbols.hpp"
 
+#include <stdexcept>
+
 Symbols::Symbols(const std::initializer_list<std::pair<std::string, ConstantValue>> _constants,
                  const std::initializer_list<std::string> _variables)
     : constants([&_constants]()
@@ -73,4 +75,17 @@ ConstantValue Symbols::getConstValue(const std::string& query) const
     }
 
     return CONST_NOT_FOUND;
+}
+
+const std::string& Symbols::getConstLexeme(const ConstantValue value) const
+{
+    for (const Constant& constant : constants)
+    {
+        if (constant.value == value)
+        {
+            return constant.lexeme;
+        }
+    }
+
+    throw std::runtime_error("No constant registered for value " + std::to_string(value) + " in Symbols.getConstLexeme()");
 }
\ No newline at end of file
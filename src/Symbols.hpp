@@ -46,6 +46,7 @@ public:
     bool isConstant(const std::string&) const;
     bool isVariable(const std::string&) const;
     ConstantValue getConstValue(const std::string&) const;
+    const std::string& getConstLexeme(ConstantValue) const;
 };
 
 
@@ -2,68 +2,214 @@
 // Created by Aubrey on 10/19/2024.
 //
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
 #include "Transformer.hpp"
 
 Transformer::Transformer(const Symbols& _symbols,
                          const Operators& _ops,
-                         const std::initializer_list<std::pair<std::string,std::string>>& _transforms)
+                         const std::initializer_list<std::pair<std::string,std::string>>& _transforms,
+                         const bool _fold_constants)
     : symbols(_symbols),
-      transforms([&_ops, &_transforms, &_symbols]()
+      rules([&_ops, &_transforms, &_symbols]()
       {
-          std::vector<std::pair<AST,AST>> temp;
+          std::vector<Rule> temp;
           for (const auto& pair : _transforms)
           {
-              temp.emplace_back(AST(_symbols, _ops, pair.first), AST(_symbols, _ops, pair.second));
+              AST pattern(_symbols, _ops, pair.first);
+              AST replacement(_symbols, _ops, pair.second);
+              RulePhase phase = classify(pattern, replacement);
+              temp.emplace_back(std::move(pattern), std::move(replacement), pair.first + " -> " + pair.second, phase);
           }
           return temp;
       }()),
-      ops(_ops) // lambda function to construct ASTs using the initializer list of string pairs, and use the ASTs to
-           // initialize the vector
+      schedule([this]()
+      {
+          std::vector<size_t> temp(rules.size());
+          for (size_t i=0; i<temp.size(); i++)
+          {
+              temp[i] = i;
+          }
+          std::stable_sort(temp.begin(), temp.end(), [this](size_t a, size_t b)
+          {
+              return rules[a].phase < rules[b].phase;
+          });
+          return temp;
+      }()),
+      ops(_ops), // lambda functions to construct the rules from the initializer list of string pairs, and to sort them
+                 // into phases while keeping the given order within a phase
+      simplifier(_symbols, _ops),
+      fold_constants(_fold_constants)
     {}
 
-void Transformer::applyTransformations(AST& wff)
+void Transformer::setTrace(const bool _trace)
 {
-    bool applied_transform = false;
-    do
+    trace = _trace;
+}
+
+RulePhase Transformer::classify(const AST& pattern, const AST& replacement)
+{
+    std::map<std::string,int> pattern_uses;
+    std::map<std::string,int> replacement_uses;
+    std::function<size_t(const AST_node*, std::map<std::string,int>&)> count;
+    count = [&count](const AST_node* curr, std::map<std::string,int>& uses)
     {
-        applied_transform = traverseAndApplyTransformations(wff, wff.getRoot());
-    } while (applied_transform);
+        size_t size = 1;
+        if (curr->token.type == VARIABLE)
+        {
+            uses[curr->token.lexeme]++;
+        }
+        for (const AST_node* child : curr->children)
+        {
+            size += count(child, uses);
+        }
+        return size;
+    };
+
+    size_t pattern_size = count(pattern.getRoot(), pattern_uses);
+    size_t replacement_size = count(replacement.getRoot(), replacement_uses);
+
+    for (const auto& pair : replacement_uses)
+    {
+        if (pair.second > pattern_uses[pair.first])
+        {
+            return PHASE_EXPAND; // A bound subtree gets copied
+        }
+    }
+    return replacement_size < pattern_size ? PHASE_SIMPLIFY : PHASE_NORMALIZE;
 }
 
-bool Transformer::traverseAndApplyTransformations(AST& wff, const AST_node* curr)
+void Transformer::applyTransformations(AST& wff)
 {
-    bool applied_transform = false;
+    if (fold_constants)
+    {
+        simplifier.simplify(wff);
+    }
 
-    for (const std::pair<AST,AST>& pattern : transforms)
+    // Only open a phase once every earlier one has nothing left to do, and drop back to the first phase after any
+    // rewrite, since e.g. distribution often creates something that simplifies
+    int phase = PHASE_SIMPLIFY;
+    while (phase < PHASE_COUNT)
     {
+        bool applied_transform = traverseAndApplyTransformations(wff, wff.getMutableRoot(), static_cast<RulePhase>(phase));
+        reorderRules();
+        phase = applied_transform ? PHASE_SIMPLIFY : phase + 1;
+    }
+}
+
+bool Transformer::applyFirstMatchingRule(AST& wff, AST_node* curr, const RulePhase max_phase)
+{
+    for (size_t index : schedule)
+    {
+        Rule& rule = rules[index];
+        if (rule.phase > max_phase)
+        {
+            break; // The schedule is sorted by phase
+        }
+
+        // Bindings are deep copies made while matching, so the node counts for a rule start before the match
+        size_t created_before = MemoryStats::getNodesCreated();
+        size_t freed_before = MemoryStats::getNodesFreed();
         std::map<std::string,AST_node*> bindings;
-        bool match = this->match(curr, pattern.first.getRoot(), bindings);
-        if (match)
+        match_visits = 0;
+        bool match = this->match(curr, rule.pattern.getRoot(), bindings);
+        rule.attempts++;
+        rule.match_cost += match_visits;
+        if (!match)
+        {
+            freeBindings(bindings);
+            continue;
+        }
+
+        if (trace)
         {
             std::cout << wff.toString() << std::endl;
-            AST_node* populated_pattern = deep_copy(pattern.second.getRoot());
-            applyBindings(populated_pattern, bindings);
-            wff.replaceNode(curr, populated_pattern);
-            applied_transform = true;
         }
+        AST_node* populated_pattern = deep_copy(rule.replacement.getRoot());
+        applyBindings(populated_pattern, bindings);
+        replaceInPlace(curr, populated_pattern);
+        freeBindings(bindings);
+        if (fold_constants)
+        {
+            simplifier.simplifySubtree(curr);
+        }
+
+        MemoryStats::ruleApplied(rule.name,
+                                 MemoryStats::getNodesCreated() - created_before,
+                                 MemoryStats::getNodesFreed() - freed_before);
+        rule.hits++;
+        return true;
+    }
+    return false;
+}
+
+bool Transformer::traverseAndApplyTransformations(AST& wff, AST_node* curr, const RulePhase max_phase)
+{
+    // Keep rewriting this node until no rule matches its new contents. Every scan starts again from the front of the
+    // schedule, because the rule that just fired has changed what curr is.
+    bool applied_transform = false;
+    while (applyFirstMatchingRule(wff, curr, max_phase))
+    {
+        applied_transform = true;
     }
 
     // traverse down
-    for (const AST_node* child : curr->children)
+    bool applied_below = false;
+    for (AST_node* child : curr->children)
     {
-        if (traverseAndApplyTransformations(wff, child))
+        if (traverseAndApplyTransformations(wff, child, max_phase))
         {
-            applied_transform = true;
+            applied_below = true;
         }
     }
 
-    return applied_transform;
+    // A rewrite below may have produced a constant or complement that now folds this node too
+    if (applied_below && fold_constants)
+    {
+        simplifier.foldNode(curr);
+    }
+
+    return applied_transform || applied_below;
+}
+
+void Transformer::reorderRules()
+{
+    // Within a phase, try first the rules that match most often per pattern node visited. The +1/+2 keeps rules that
+    // have not been tried yet in the middle instead of at either end.
+    std::vector<double> payoff(rules.size());
+    for (size_t i=0; i<rules.size(); i++)
+    {
+        double hit_rate = (rules[i].hits + 1.0) / (rules[i].attempts + 2.0);
+        double cost = (rules[i].match_cost + 1.0) / (rules[i].attempts + 1.0);
+        payoff[i] = hit_rate / cost;
+    }
+    std::stable_sort(schedule.begin(), schedule.end(), [this, &payoff](size_t a, size_t b)
+    {
+        if (rules[a].phase != rules[b].phase)
+        {
+            return rules[a].phase < rules[b].phase;
+        }
+        return payoff[a] > payoff[b];
+    });
+}
+
+void Transformer::replaceInPlace(AST_node* curr, AST_node* new_node)
+{
+    // new_node is freshly built and owned by us, so its contents can be moved into curr instead of copied
+    for (AST_node* child : curr->children)
+    {
+        AST::deleteTree(child);
+    }
+    curr->token = new_node->token;
+    curr->children.swap(new_node->children);
+    new_node->children.clear();
+    delete new_node;
 }
 
 bool Transformer::match(const AST_node* wff,
                         const AST_node* pattern,
-                        std::map<std::string,AST_node*>& bindings) const
+                        std::map<std::string,AST_node*>& bindings)
 {
     // Match is based on a traversal function, so start at the root and traverse down to the next node:
     //   - If the current node in the pattern is an operator then check if it's the same operator
@@ -71,6 +217,7 @@ bool Transformer::match(const AST_node* wff,
     //   - Else if the current node in the pattern is an identifier, then check if that identifier is bound to an
     //     identical WFF to the current node. If it is bound to something else, return false. Else if it is not
     //     bound to anything, bind the current wff node to the pattern's identifier.
+    match_visits++;
 
     if (ops.matchesOperator(pattern->token.lexeme) == MATCH_TRUE)
     {
@@ -92,6 +239,8 @@ bool Transformer::match(const AST_node* wff,
         else // unbound
         {
             bindings.insert({pattern->token.lexeme, deep_copy(wff)});
+            MemoryStats::allocated(ALLOC_BINDINGS,
+                                   sizeof(std::pair<const std::string,AST_node*>) + pattern->token.lexeme.size());
         }
     }
     else // pattern token is a constant
@@ -119,7 +268,9 @@ void Transformer::applyBindings(AST_node*& root, const std::map<std::string,AST_
 {
     if (root->token.type == VARIABLE)
     {
-        root = deep_copy(bindings.at(root->token.lexeme));
+        AST_node* bound = deep_copy(bindings.at(root->token.lexeme));
+        delete root; // Pattern variables are leaves, so there are no children to free
+        root = bound;
         return;
     }
 
@@ -127,4 +278,14 @@ void Transformer::applyBindings(AST_node*& root, const std::map<std::string,AST_
     {
         applyBindings(child, bindings);
     }
+}
+
+void Transformer::freeBindings(std::map<std::string,AST_node*>& bindings)
+{
+    for (auto& pair : bindings)
+    {
+        MemoryStats::released(ALLOC_BINDINGS, sizeof(std::pair<const std::string,AST_node*>) + pair.first.size());
+        AST::deleteTree(pair.second);
+    }
+    bindings.clear();
 }
\ No newline at end of file
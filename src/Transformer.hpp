@@ -7,6 +7,7 @@
 
 #include "AST.hpp"
 #include "Operators.hpp"
+#include "Simplifier.hpp"
 #include "Symbols.hpp"
 #include <map>
 #include <string>
@@ -21,21 +22,67 @@
 //
 // Every tuple represents a WFF AST and another AST that it can transform into.
 // For example a=>b can transform into !a+b, so there should be a tuple that looks like this (a=>b, !a+b).
+//
+// With fold_constants, constants and complements are folded by the Simplifier instead of by rules: once over the whole
+// WFF before the first pass, then after each rewrite on just the rewritten subtree and its ancestors.
+//
+// Rules are scheduled rather than tried in the order they were given. Each rule is put in a phase by comparing its two
+// sides: SIMPLIFY rules shrink the formula, NORMALIZE rules grow it without copying any subtree, and EXPAND rules
+// (like distribution) copy a bound subtree. A pass only uses the rules up to the current phase, and the next phase is
+// only opened once the earlier ones have reached a fixpoint, so nothing is distributed that a cheaper rule could have
+// removed first. After every pass the rules within a phase are reordered by how often they have matched relative to
+// how many pattern nodes their match attempts visit.
+enum RulePhase
+{
+    PHASE_SIMPLIFY,
+    PHASE_NORMALIZE,
+    PHASE_EXPAND,
+    PHASE_COUNT
+};
+
 class Transformer
 {
 private:
+    struct Rule
+    {
+        AST pattern;
+        AST replacement;
+        std::string name; // "pattern -> replacement", used as the key for per-rule stats
+        RulePhase phase;
+        size_t attempts = 0;
+        size_t hits = 0;
+        size_t match_cost = 0; // Pattern nodes visited over all attempts
+
+        Rule(AST _pattern, AST _replacement, std::string _name, RulePhase _phase)
+            : pattern(std::move(_pattern)), replacement(std::move(_replacement)), name(std::move(_name)), phase(_phase) {}
+    };
+
     const Symbols symbols;
-    const std::vector<std::pair<AST,AST>> transforms;
+    std::vector<Rule> rules;
+    std::vector<size_t> schedule; // Indexes into rules, sorted by phase and then by observed payoff
     const Operators ops;
+    const Simplifier simplifier;
+    const bool fold_constants;
+    bool trace = false;
+    size_t match_visits = 0;
 
-    bool match(const AST_node*, const AST_node*, std::map<std::string,AST_node*>&) const;
+    static RulePhase classify(const AST&, const AST&);
+    bool match(const AST_node*, const AST_node*, std::map<std::string,AST_node*>&);
     static void applyBindings(AST_node*&, const std::map<std::string,AST_node*>&);
-    bool traverseAndApplyTransformations(AST&, const AST_node*);
+    static void freeBindings(std::map<std::string,AST_node*>&);
+    static void replaceInPlace(AST_node*, AST_node*);
+    bool applyFirstMatchingRule(AST&, AST_node*, RulePhase);
+    bool traverseAndApplyTransformations(AST&, AST_node*, RulePhase);
+    void reorderRules();
 
 public:
-    Transformer(const Symbols&, const Operators&, const std::initializer_list<std::pair<std::string,std::string>>&);
+    Transformer(const Symbols&,
+                const Operators&,
+                const std::initializer_list<std::pair<std::string,std::string>>&,
+                bool fold_constants = true);
 
     void applyTransformations(AST&);
+    void setTrace(bool); // Print the whole WFF before every rewrite
 };
 
 #endif //WFF2CNF_TRANSFORMER_HPP
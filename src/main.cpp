@@ -3,97 +3,163 @@
 //
 
 #include "AST.hpp"
+#include "BinaryAST.hpp"
+#include "MemoryStats.hpp"
+#include "Minimizer.hpp"
 #include "Operators.hpp"
+#include "ParityEncoder.hpp"
+#include "Serializer.hpp"
+#include "Simplifier.hpp"
 #include "Symbols.hpp"
 #include "Transformer.hpp"
 #include <chrono>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 
-int main() {
-    auto start_time = std::chrono::high_resolution_clock::now();
-
-    Symbols symbols =
+int main(int argc, char* argv[]) {
+    bool print_stats = false;
+    std::string stats_path;        // Write the stats JSON to this file instead of stderr
+    bool trace = false;
+    std::string read_binary_path;  // Read the WFF from a binary AST file instead of using the default formula
+    std::string write_binary_path; // Also write the resulting CNF as a binary AST file
+    for (int i=1; i<argc; i++)
     {
+        std::string arg = argv[i];
+        if (arg == "--stats")
+        {
+            print_stats = true;
+        }
+        else if (arg.compare(0, 8, "--stats=") == 0 && arg.size() > 8)
+        {
+            print_stats = true;
+            stats_path = arg.substr(8);
+        }
+        else if (arg == "--trace")
+        {
+            trace = true;
+        }
+        else if ((arg == "--read-binary" || arg == "--write-binary") && i+1 < argc)
         {
-            {"1", CONST_TRUE}, // Constants
-            {"0", CONST_FALSE}
-        },
+            (arg == "--read-binary" ? read_binary_path : write_binary_path) = argv[++i];
+        }
+        else
         {
-            {"a"}, // Variables
-            {"b"},
-            {"c"},
-            {"p"},
-            {"q"},
-            {"r"},
-            {"s"},
-            {"t"}
+            std::cerr << "Unknown argument '" << arg << "'" << std::endl;
+            return 1;
         }
-    };
+    }
 
-    Operators ops = {
-            {"!", {3, NOT_ASSOCIATIVE, UNARY}},
-            {"*", {2, ASSOCIATIVE, BINARY}},
-            {"+", {1, ASSOCIATIVE, BINARY}},
-            {"=>", {0 , NOT_ASSOCIATIVE, BINARY}}
-    };
+    try
+    {
+        auto start_time = std::chrono::high_resolution_clock::now();
 
-    Transformer wff2cnf = {symbols, ops,
+        Symbols symbols =
+        {
+            {
+                {"1", CONST_TRUE}, // Constants
+                {"0", CONST_FALSE}
+            },
             {
-                {"a=>b", "!a+b"},           // Implication
-                {"!(a+b)", "!a*!b"},        // De Morgan's Law
-                {"!(a*b)", "!a+!b"},
-                {"a*a", "a"},               // Identity
-                {"a+a", "a"},
-                {"a*1", "a"},               // Identities of Operators
-                {"1*a", "a"},
-                {"a+0", "a"},
-                {"0+a", "a"},
-                {"a*0", "0"},
-                {"0*a", "0"},
-                {"a+1", "1"},
-                {"1+a", "1"},
-                {"a+!a", "1"},              // Complement
-                {"!a+a", "1"},
-                {"a*!a", "0"},
-                {"!a*a", "0"},
-                {"a+(a*b)", "a"},           // Absorption (8 scenarios)
-                {"a+(b*a)", "a"},
-                {"(a*b)+a", "a"},
-                {"(b*a)+a", "a"},
-                {"a*(a+b)", "a"},
-                {"a*(b+a)", "a"},
-                {"(a+b)*a", "a"},
-                {"(b+a)*a", "a"},
-                {"(a+b)*(!b+c)", "a+c"},    // Resolution (8 scenarios)
-                {"(a+b)*(c+!b)", "a+c"},
-                {"(b+a)*(!b+c)", "a+c"},
-                {"(b+a)*(c+!b)", "a+c"},
-                {"(!b+c)*(a+b)", "a+c"},
-                {"(c+!b)*(a+b)", "a+c"},
-                {"(!b+c)*(b+a)", "a+c"},
-                {"(c+!b)*(b+a)", "a+c"},
-                {"(a*b)+c", "(a+c)*(b+c)"}, // Distribution
-                {"c+(a*b)", "(a+c)*(b+c)"},
-                {"!!a", "a"}                // Remove double negation
+                {"a"}, // Variables
+                {"b"},
+                {"c"},
+                {"p"},
+                {"q"},
+                {"r"},
+                {"s"},
+                {"t"}
             }
         };
 
-    //std::string formula;
-    //std::cout << "Enter a WFF: ";
-    //std::getline(std::cin, formula);
-    //AST wff(symbols, ops, formula);
+        Operators ops = {
+                {"!", {5, NOT_ASSOCIATIVE, UNARY, OP_NOT}},
+                {"*", {4, ASSOCIATIVE, BINARY, OP_AND}},
+                {"^", {3, ASSOCIATIVE, BINARY, OP_XOR}},
+                {"+", {2, ASSOCIATIVE, BINARY, OP_OR}},
+                {"=>", {1, NOT_ASSOCIATIVE, BINARY, OP_IMPLIES}},
+                {"<=>", {0, NOT_ASSOCIATIVE, BINARY, OP_IFF}}
+        };
+
+        Simplifier simplifier(symbols, ops);
+        ParityEncoder parity_encoder(symbols, ops);
+        Minimizer minimizer(symbols, ops);
+
+        Transformer wff2cnf = {symbols, ops,
+                {
+                    {"a=>b", "!a+b"},           // Implication
+                    {"!(a+b)", "!a*!b"},        // De Morgan's Law
+                    {"!(a*b)", "!a+!b"},
+                    {"a*a", "a"},               // Identity
+                    {"a+a", "a"},
+                    {"a+(a*b)", "a"},           // Absorption (8 scenarios)
+                    {"a+(b*a)", "a"},
+                    {"(a*b)+a", "a"},
+                    {"(b*a)+a", "a"},
+                    {"a*(a+b)", "a"},
+                    {"a*(b+a)", "a"},
+                    {"(a+b)*a", "a"},
+                    {"(b+a)*a", "a"},
+                    {"(a*b)+c", "(a+c)*(b+c)"}, // Distribution
+                    {"c+(a*b)", "(a+c)*(b+c)"},
+                    {"!!a", "a"}                // Remove double negation
+                }
+            };
+
+        //std::string formula;
+        //std::cout << "Enter a WFF: ";
+        //std::getline(std::cin, formula);
+        //AST wff(symbols, ops, formula);
 
-    AST wff(symbols, ops, "(p+!(q*r))=>((p+s)*t)");
-    //AST wff(symbols, ops, "!q+p+q");
+        BinaryAST binary(symbols, ops);
+        AST wff = read_binary_path.empty() ? AST(symbols, ops, "(p+!(q*r))=>((p+s)*t)")
+                                           : binary.readFile(read_binary_path);
+        //AST wff(symbols, ops, "!q+p+q");
 
-    wff2cnf.applyTransformations(wff);
+        wff2cnf.setTrace(trace);
+        simplifier.simplify(wff); // Fold constants first so they don't end up in parity chains
+        parity_encoder.encode(wff); // ^ and <=> have no rewrite rules, they are encoded directly
+        minimizer.minimize(wff); // Small cones go straight to a small CNF instead of through distribution
+        wff2cnf.applyTransformations(wff);
 
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+        auto end_time = std::chrono::high_resolution_clock::now();
+        auto elapsed_time = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+
+        std::cout << "\nCNF: ";
+        Serializer(ops).write(wff.getRoot(), std::cout); // Streams the CNF without building it as one string first
+        std::cout << std::endl;
+        std::cout << "Completed in: " << elapsed_time.count() << " microseconds" << std::endl;
+
+        if (!write_binary_path.empty())
+        {
+            binary.writeFile(write_binary_path, wff, BinaryAST::FLAG_SHARED_SUBTREES);
+        }
+    }
+    catch (const std::runtime_error& error)
+    {
+        // e.g. a --read-binary file that is missing or corrupt, or a --write-binary path that can't be written
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
 
-    std::cout << "\nCNF: " << wff.toString() << std::endl;
-    std::cout << "Completed in: " << elapsed_time.count() << " microseconds" << std::endl;
+    // Written after every AST has gone out of scope, so a non-zero live_nodes means something leaked. Never to stdout,
+    // where it would be mixed with the CNF and the trace
+    if (print_stats && stats_path.empty())
+    {
+        MemoryStats::writeJson(std::cerr);
+    }
+    else if (print_stats)
+    {
+        std::ofstream stats_file(stats_path);
+        MemoryStats::writeJson(stats_file);
+        stats_file.close();
+        if (!stats_file)
+        {
+            std::cerr << "Could not write '" << stats_path << "'" << std::endl;
+            return 1;
+        }
+    }
 
     return 0;
 }
@@ -104,3 +170,5 @@ int main() {
 // a * (b+!c) => !d
 // !a * (b+!c) => !d
 // (a+(b*c))+d
+// a<=>b
+// (p*q)^r^s^t^(a=>b)
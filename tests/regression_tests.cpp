@@ -0,0 +1,590 @@
+#include "src/AST.hpp"
+#include "src/BinaryAST.hpp"
+#include "src/BulkEvaluator.hpp"
+#include "src/CNFBuilder.hpp"
+#include "src/CompactAST.hpp"
+#include "src/MemoryStats.hpp"
+#include "src/Minimizer.hpp"
+#include "src/Operators.hpp"
+#include "src/ParityEncoder.hpp"
+#include "src/Preprocessor.hpp"
+#include "src/Serializer.hpp"
+#include "src/Simplifier.hpp"
+#include "src/Symbols.hpp"
+#include "src/Transformer.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <set>
+#include <string>
+#include <vector>
+
+static const Symbols symbols =
+{
+    {
+        {"1", CONST_TRUE},
+        {"0", CONST_FALSE}
+    },
+    {
+        {"a"}, {"b"}, {"c"}, {"p"}, {"q"}, {"r"}, {"s"}, {"t"}
+    }
+};
+
+static const Operators ops = {
+        {"!", {5, NOT_ASSOCIATIVE, UNARY, OP_NOT}},
+        {"*", {4, ASSOCIATIVE, BINARY, OP_AND}},
+        {"^", {3, ASSOCIATIVE, BINARY, OP_XOR}},
+        {"+", {2, ASSOCIATIVE, BINARY, OP_OR}},
+        {"=>", {1, NOT_ASSOCIATIVE, BINARY, OP_IMPLIES}},
+        {"<=>", {0, NOT_ASSOCIATIVE, BINARY, OP_IFF}}
+};
+
+static int failures = 0;
+
+static void check(const bool condition, const std::string& message)
+{
+    if (!condition)
+    {
+        std::cerr << "FAILED: " << message << std::endl;
+        failures++;
+    }
+}
+
+static Transformer makeTransformer()
+{
+    // The rules main uses
+    return Transformer(symbols, ops,
+        {
+            {"a=>b", "!a+b"},
+            {"!(a+b)", "!a*!b"},
+            {"!(a*b)", "!a+!b"},
+            {"a*a", "a"},
+            {"a+a", "a"},
+            {"a+(a*b)", "a"},
+            {"a+(b*a)", "a"},
+            {"(a*b)+a", "a"},
+            {"(b*a)+a", "a"},
+            {"a*(a+b)", "a"},
+            {"a*(b+a)", "a"},
+            {"(a+b)*a", "a"},
+            {"(b+a)*a", "a"},
+            {"(a*b)+c", "(a+c)*(b+c)"},
+            {"c+(a*b)", "(a+c)*(b+c)"},
+            {"!!a", "a"}
+        });
+}
+
+static size_t countClauses(const AST_node* curr)
+{
+    if (curr->token.type == OPERATOR && ops.getProperties(curr->token.lexeme).kind == OP_AND)
+    {
+        return countClauses(curr->children[0]) + countClauses(curr->children[1]);
+    }
+    return 1;
+}
+
+// Whether cnf, with its extra variables existentially quantified, has the same models as wff. Brute force over every
+// assignment of the variables of both, 64 at a time.
+static bool equisatisfiable(const AST& wff, const AST& cnf)
+{
+    CompactAST original(symbols, ops, wff);
+    CompactAST encoded(symbols, ops, cnf);
+    std::vector<std::string> names = original.getVariables();
+    const size_t num_original = names.size();
+    for (const std::string& name : encoded.getVariables())
+    {
+        if (std::find(names.begin(), names.end(), name) == names.end())
+        {
+            names.push_back(name);
+        }
+    }
+
+    auto columnsFor = [&](const CompactAST& tree, size_t first)
+    {
+        std::vector<uint64_t> values;
+        for (const std::string& name : tree.getVariables())
+        {
+            size_t v = std::find(names.begin(), names.end(), name) - names.begin();
+            uint64_t column = 0;
+            for (size_t j=0; j<64; j++)
+            {
+                column |= static_cast<uint64_t>(((first + j) >> v) & 1) << j;
+            }
+            values.push_back(column);
+        }
+        return values;
+    };
+
+    const size_t assignments = size_t(1) << names.size();
+    std::vector<bool> wanted(size_t(1) << num_original);
+    std::vector<bool> found(size_t(1) << num_original, false);
+    for (size_t first=0; first<std::max<size_t>(assignments, 64); first+=64)
+    {
+        uint64_t expected = original.evaluate(columnsFor(original, first));
+        uint64_t actual = encoded.evaluate(columnsFor(encoded, first));
+        for (size_t j=0; j<64 && first + j < assignments; j++)
+        {
+            size_t projection = (first + j) & ((size_t(1) << num_original) - 1);
+            wanted[projection] = (expected >> j) & 1;
+            found[projection] = found[projection] || ((actual >> j) & 1);
+        }
+    }
+    return wanted == found;
+}
+
+static void testParityChains()
+{
+    // Chains nested under ! or inside other gates used to have their expanded CNF negated and redistributed, which
+    // blew up exponentially
+    const std::vector<std::string> formulas = {
+        "((a^b^c)*q)^r",
+        "!(a^b^c^p)^r",
+        "((a^b^c^p)*q)^r",
+        "!(a^b^c^p)",
+        "(a^b^c^p)=>q",
+        "!((a^b)*(c^p))",
+        "(a<=>b)<=>(c<=>(p*q))",
+        "((((p=>!a)^((p<=>a)<=>q))*b)<=>(((q*b*q)+(!p^(q*b)))<=>(p=>!b)))+(((p<=>a)*a)^(((q+a)<=>(b^a))<=>(!b+(q*b))))"
+    };
+
+    Simplifier simplifier(symbols, ops);
+    ParityEncoder parity_encoder(symbols, ops);
+    Transformer transformer = makeTransformer();
+    for (const std::string& formula : formulas)
+    {
+        AST wff(symbols, ops, formula);
+        AST cnf(wff);
+        simplifier.simplify(cnf);
+        parity_encoder.encode(cnf);
+        transformer.applyTransformations(cnf);
+
+        check(countClauses(cnf.getRoot()) <= 200, formula + " produced " + std::to_string(countClauses(cnf.getRoot()))
+                                                  + " clauses");
+        check(equisatisfiable(wff, cnf), formula + " is not equisatisfiable with " + cnf.toString());
+    }
+}
+
+// Leaves are constants and single-letter variables from the given ones, possibly negated
+static std::string randomFormula(std::mt19937& rng, const int depth, const std::string& variables = "abc")
+{
+    static const char* const BINARY_OPERATORS[] = {"*", "+", "=>", "^", "<=>"};
+    if (depth == 0 || rng() % 4 == 0)
+    {
+        const unsigned leaf = rng() % 6;
+        const std::string variable(1, variables[rng() % variables.size()]);
+        return leaf == 0 ? "0" : leaf == 1 ? "1" : leaf == 5 ? "!" + variable : variable;
+    }
+    if (rng() % 6 == 0)
+    {
+        return "!(" + randomFormula(rng, depth - 1, variables) + ")";
+    }
+    return "(" + randomFormula(rng, depth - 1, variables) + ")" + BINARY_OPERATORS[rng() % 5] + "("
+           + randomFormula(rng, depth - 1, variables) + ")";
+}
+
+static void testSimplifierEquivalence()
+{
+    // Skipping the right operand after an absorbing left one must not change what the WFF means
+    std::mt19937 rng(30);
+    Simplifier simplifier(symbols, ops);
+    for (int round=0; round<2000; round++)
+    {
+        const std::string formula = randomFormula(rng, 5);
+        AST wff(symbols, ops, formula);
+        AST simplified(wff);
+        simplifier.simplify(simplified);
+        if (!equisatisfiable(wff, simplified))
+        {
+            check(false, formula + " simplified to " + simplified.toString());
+            return;
+        }
+    }
+
+    AST absorbed(symbols, ops, "0*((a^b)+(c=>1))");
+    simplifier.simplify(absorbed);
+    check(absorbed.toString() == "0", "0*((a^b)+(c=>1)) simplified to " + absorbed.toString());
+}
+
+static void testMinimizerEquivalence()
+{
+    // Cones of up to 8 variables get an exact prime cover and bigger ones the heuristic one, and both have to keep the
+    // function. Needs more variables than the other tests.
+    const Symbols wide_symbols =
+    {
+        {
+            {"1", CONST_TRUE},
+            {"0", CONST_FALSE}
+        },
+        {
+            {"a"}, {"b"}, {"c"}, {"d"}, {"e"}, {"f"}, {"g"}, {"h"}, {"i"}, {"j"}, {"k"}, {"l"}
+        }
+    };
+    Minimizer minimizer(wide_symbols, ops);
+    std::mt19937 rng(34);
+    size_t exact = 0;
+    size_t heuristic = 0;
+    for (int round=0; round<600; round++)
+    {
+        const bool wide = round % 2 == 1;
+        const std::string formula = randomFormula(rng, wide ? 9 : 6, wide ? "abcdefghijkl" : "abcdefgh");
+        AST wff(wide_symbols, ops, formula);
+        const size_t support = CompactAST(wide_symbols, ops, wff).getVariables().size();
+        (support > 8 ? heuristic : exact)++;
+
+        AST minimized(wff);
+        minimizer.minimize(minimized);
+        if (!equisatisfiable(wff, minimized))
+        {
+            check(false, formula + " minimized to " + minimized.toString());
+            return;
+        }
+    }
+    check(exact > 100 && heuristic > 100, "Only " + std::to_string(exact) + " exact and " + std::to_string(heuristic)
+                                          + " heuristic covers were tested");
+}
+
+// The builder's clause database as a WFF, so it can be compared with the formulas that were added to it
+static AST clausesToAst(const CNFBuilder& builder)
+{
+    AST_node* root = new AST_node(Token(CONSTANT, "1"));
+    for (const Clause& clause : builder.getClauses())
+    {
+        AST_node* disjunction = new AST_node(Token(CONSTANT, "0"));
+        for (int literal : clause)
+        {
+            AST_node* node = new AST_node(Token(VARIABLE, builder.getVariableName(literal)));
+            if (literal < 0)
+            {
+                AST_node* negation = new AST_node(Token(OPERATOR, "!"));
+                negation->children.push_back(node);
+                node = negation;
+            }
+            AST_node* parent = new AST_node(Token(OPERATOR, "+"));
+            parent->children = {disjunction, node};
+            disjunction = parent;
+        }
+        AST_node* parent = new AST_node(Token(OPERATOR, "*"));
+        parent->children = {root, disjunction};
+        root = parent;
+    }
+    return AST(symbols, ops, root);
+}
+
+static void testCNFBuilder()
+{
+    // Clauses added one WFF at a time, sharing aux variables between calls, must describe the same function of the user
+    // variables as the conjunction of the WFFs, just like converting the conjunction in one go
+    const std::string chain = "a^b^c^p^q^r";
+    std::mt19937 rng(29);
+    for (int round=0; round<60; round++)
+    {
+        CNFBuilder incremental(symbols, ops, makeTransformer());
+        std::string conjunction = "1";
+        for (int part=0; part<3; part++)
+        {
+            std::string formula = randomFormula(rng, 4, "abcpq");
+            if (rng() % 2)
+            {
+                formula = "(" + chain + ")" + (rng() % 2 ? "+" : "<=>") + "(" + formula + ")";
+            }
+            incremental.add(formula);
+            conjunction += "*(" + formula + ")";
+        }
+        CNFBuilder one_shot(symbols, ops, makeTransformer());
+        one_shot.add(conjunction);
+
+        AST wff(symbols, ops, conjunction);
+        if (incremental.getNumVariables() <= 20 && !equisatisfiable(wff, clausesToAst(incremental)))
+        {
+            check(false, "Adding the parts of " + conjunction + " one at a time changed its function");
+            return;
+        }
+        if (one_shot.getNumVariables() <= 20 && !equisatisfiable(wff, clausesToAst(one_shot)))
+        {
+            check(false, "Adding " + conjunction + " in one go changed its function");
+            return;
+        }
+    }
+
+    // A chain that was already chunked reuses its aux variables, so only s is new
+    CNFBuilder builder(symbols, ops, makeTransformer());
+    builder.add(chain);
+    const int num_variables = builder.getNumVariables();
+    builder.add("s+(" + chain + ")");
+    check(builder.getNumVariables() == num_variables + 1, "A repeated XOR chain got new aux variables");
+
+    // Until they are committed, the aux variables of one encode() must not be reused by the next
+    ParityEncoder parity_encoder(symbols, ops);
+    AST uncommitted(symbols, ops, chain);
+    parity_encoder.encode(uncommitted, true);
+    AST encoded(symbols, ops, chain);
+    parity_encoder.encode(encoded, true);
+    check(equisatisfiable(AST(symbols, ops, chain), encoded), "Uncommitted aux variables were reused");
+
+    // A WFF that fails to convert leaves nothing behind. Folding constants would turn a=>0 straight back into !a.
+    CNFBuilder failing(symbols, ops, Transformer(symbols, ops, {{"!a", "a=>0"}}, false));
+    try
+    {
+        failing.add(chain);
+        check(false, "A clause with => was accepted by CNFBuilder.add()");
+    }
+    catch (const std::runtime_error&)
+    {
+        check(failing.getNumVariables() == 0 && failing.getClauses().empty(), "A failed add() kept variables");
+    }
+}
+
+static void testBulkEvaluator()
+{
+    // satisfying() has to agree with CompactAST::evaluate() bit for bit, including across blocks and in a partial last
+    // word, whichever kernel was compiled in
+    std::mt19937 rng(35);
+    std::vector<std::string> formulas = {"1", "0", "!0", "a", "!a", "a=>0", "1=>a", "(a=>b)=>(b=>a)", "!(a*1)+(0^b)"};
+    for (int round=0; round<200; round++)
+    {
+        formulas.push_back(randomFormula(rng, 2 + round % 6));
+    }
+    const size_t assignment_counts[] = {1, 63, 64, 65, 200, 64 * 64 + 7, 3 * 64 * 64};
+
+    for (const std::string& formula : formulas)
+    {
+        AST wff(symbols, ops, formula);
+        BulkEvaluator evaluator(symbols, ops, wff);
+        CompactAST compact(symbols, ops, wff);
+        for (size_t num_assignments : assignment_counts)
+        {
+            const size_t words = (num_assignments + 63) / 64;
+            std::vector<std::vector<uint64_t>> columns(evaluator.getVariables().size(), std::vector<uint64_t>(words));
+            std::vector<const uint64_t*> column_pointers;
+            for (std::vector<uint64_t>& column : columns)
+            {
+                for (uint64_t& word : column)
+                {
+                    word = (static_cast<uint64_t>(rng()) << 32) | rng();
+                }
+                column_pointers.push_back(column.data());
+            }
+
+            std::vector<uint64_t> satisfying = evaluator.satisfying(column_pointers, num_assignments);
+            std::vector<uint64_t> unsatisfying = evaluator.unsatisfying(column_pointers, num_assignments);
+            size_t expected_count = 0;
+            bool agrees = satisfying.size() == words && unsatisfying.size() == words;
+            for (size_t w=0; w<words && agrees; w++)
+            {
+                std::vector<uint64_t> values;
+                for (const std::string& name : compact.getVariables())
+                {
+                    values.push_back(columns[evaluator.getVariableIndex(name)][w]);
+                }
+                const size_t valid = std::min<size_t>(64, num_assignments - 64 * w);
+                const uint64_t mask = valid == 64 ? ~0ULL : (1ULL << valid) - 1;
+                const uint64_t expected = compact.evaluate(values) & mask;
+                agrees = satisfying[w] == expected && unsatisfying[w] == (~expected & mask);
+                for (size_t j=0; j<valid; j++)
+                {
+                    expected_count += (expected >> j) & 1;
+                }
+            }
+            agrees = agrees && evaluator.countSatisfying(column_pointers, num_assignments) == expected_count;
+            if (!agrees)
+            {
+                check(false, std::string(BulkEvaluator::getKernelName()) + " BulkEvaluator disagrees on " + formula
+                             + " with " + std::to_string(num_assignments) + " assignments");
+                return;
+            }
+        }
+    }
+}
+
+#ifndef _WIN32
+static std::string writtenToFile(const Serializer& serializer, const AST& wff)
+{
+    std::FILE* file = std::tmpfile();
+    serializer.write(wff.getRoot(), fileno(file));
+    std::rewind(file);
+    std::string written;
+    char buffer[4096];
+    for (size_t n; (n = std::fread(buffer, 1, sizeof(buffer), file)) > 0; )
+    {
+        written.append(buffer, n);
+    }
+    std::fclose(file);
+    return written;
+}
+#endif
+
+static void testSerializerOutputs()
+{
+    // Every way of printing has to produce exactly the bytes toString() does
+    std::mt19937 rng(32);
+    Serializer serializer(ops);
+    std::vector<std::string> formulas;
+    for (int round=0; round<300; round++) // The deeper ones split into enough subtrees to be written in parallel
+    {
+        formulas.push_back(randomFormula(rng, 2 + round % 15));
+    }
+    // A CNF larger than one ChunkOut chunk, with the ANDs nested in balanced parentheses so its depth stays small. It
+    // still prints as one flat chain.
+    std::vector<std::string> clauses;
+    for (int i=0; i<16384; i++)
+    {
+        clauses.push_back(std::string("(") + "abcpqrst"[i % 8] + "+!" + "abcpqrst"[(i * 5 + 3) % 8] + ")");
+    }
+    while (clauses.size() > 1)
+    {
+        std::vector<std::string> joined;
+        for (size_t i=0; i<clauses.size(); i+=2)
+        {
+            joined.push_back("(" + clauses[i] + "*" + clauses[i + 1] + ")");
+        }
+        clauses.swap(joined);
+    }
+    formulas.push_back(clauses[0]);
+
+    for (const std::string& formula : formulas)
+    {
+        AST wff(symbols, ops, formula);
+        const std::string expected = serializer.toString(wff.getRoot());
+        for (unsigned threads : {1u, 2u, 3u, 8u})
+        {
+            check(serializer.toStringParallel(wff.getRoot(), threads) == expected,
+                  "toStringParallel() with " + std::to_string(threads) + " threads differs on " + formula);
+        }
+#ifndef _WIN32
+        check(writtenToFile(serializer, wff) == expected, "write(fd) differs on " + formula);
+#endif
+    }
+}
+
+static bool satisfiable(const std::vector<Clause>& clauses, const int num_variables)
+{
+    for (uint32_t assignment=0; assignment < (1u << num_variables); assignment++)
+    {
+        bool all = true;
+        for (const Clause& clause : clauses)
+        {
+            bool any = false;
+            for (int literal : clause)
+            {
+                any = any || (((assignment >> (std::abs(literal) - 1)) & 1) == (literal > 0 ? 1u : 0u));
+            }
+            all = all && any;
+        }
+        if (all)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void testPreprocessorFreeze()
+{
+    // A frozen variable fixed by unit propagation must stay fixed when the caller adds clauses on it afterwards
+    std::mt19937 rng(33);
+    const int num_variables = 6;
+    for (int round=0; round<3000; round++)
+    {
+        std::vector<Clause> clauses(1 + rng() % 10);
+        for (Clause& clause : clauses)
+        {
+            clause.resize(1 + rng() % 3);
+            for (int& literal : clause)
+            {
+                literal = static_cast<int>(1 + rng() % num_variables) * (rng() % 2 ? 1 : -1);
+            }
+        }
+        const int frozen = static_cast<int>(1 + rng() % num_variables);
+        const Clause added = {rng() % 2 ? frozen : -frozen};
+
+        Preprocessor preprocessor(clauses, num_variables);
+        preprocessor.freeze(frozen);
+        preprocessor.run();
+        std::vector<Clause> reduced = preprocessor.getClauses();
+
+        clauses.push_back(added);
+        reduced.push_back(added);
+        if (satisfiable(clauses, num_variables) != satisfiable(reduced, num_variables))
+        {
+            check(false, "Preprocessor changed satisfiability after adding a unit on frozen variable "
+                         + std::to_string(frozen));
+            return;
+        }
+    }
+}
+
+static bool rejected(const BinaryAST& binary, const std::string& data)
+{
+    try
+    {
+        binary.deserialize(data.data(), data.size());
+    }
+    catch (const std::runtime_error&)
+    {
+        return true;
+    }
+    return false;
+}
+
+static void testBinaryLimits()
+{
+    // Counts and references come from untrusted data, so none of these may allocate or copy before being rejected
+    BinaryAST binary(symbols, ops);
+    const std::string header = std::string("WFFB") + '\x01' + '\x01';
+    const std::string huge_count = "\xff\xff\xff\xff\xff\xff\xff\xff\x7f";
+    check(rejected(binary, header + huge_count), "Huge symbol count was not rejected");
+    check(rejected(binary, header + '\x00' + huge_count + '\x01'), "Huge record count was not rejected");
+
+    // 1, !1, then each record is the previous one and-ed with a copy of itself, so 60 of them expand to 2^60 nodes
+    const int doublings = 60;
+    const char not_opcode = static_cast<char>(4 + OP_NOT);
+    const char and_opcode = static_cast<char>(4 + OP_AND);
+    std::string doubling = header + '\x00' + static_cast<char>(3 + 2 * doublings) + '\x02' + not_opcode;
+    for (int i=0; i<doublings; i++)
+    {
+        doubling += std::string("\x03") + static_cast<char>(1 + 2 * i) + and_opcode;
+    }
+    doubling += not_opcode;
+    check(rejected(binary, doubling), "Exponential subtree references were not rejected");
+
+    AST shared(symbols, ops, "((a*b)+(a*b))*((a*b)+(a*b))");
+    std::string data = binary.serialize(shared, BinaryAST::FLAG_SHARED_SUBTREES);
+    check(binary.deserialize(data.data(), data.size()).toString() == shared.toString(),
+          "Shared subtrees did not round-trip");
+
+    // Only variables the reader declares, which keeps aux names like _t1 out of the ParityEncoder's input
+    for (const char* name : {"_t1", "z", ""})
+    {
+        AST_node* root = new AST_node(Token(OPERATOR, "+"));
+        root->children = {new AST_node(Token(VARIABLE, "a")), new AST_node(Token(VARIABLE, name))};
+        check(rejected(binary, binary.serialize(AST(symbols, ops, root))),
+              "Undeclared variable '" + std::string(name) + "' was not rejected");
+    }
+}
+
+int main()
+{
+    testParityChains();
+    testSimplifierEquivalence();
+    testSerializerOutputs();
+    testBulkEvaluator();
+    testMinimizerEquivalence();
+    testCNFBuilder();
+    testPreprocessorFreeze();
+    testBinaryLimits();
+
+    // Every AST above has gone out of scope with its test, so any live node is a leak
+    check(MemoryStats::getLiveNodes() == 0, std::to_string(MemoryStats::getLiveNodes()) + " AST nodes leaked");
+
+    if (failures > 0)
+    {
+        std::cerr << failures << " checks failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}